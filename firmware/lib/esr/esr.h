@@ -4,7 +4,10 @@
 #include "esr_conf.h"
 #include "esr_errors.h"
 #include "esr_io.h"
+#include "esr_format.h"
 #include "esr_kernel.h"
+#include "esr_coroutine.h"
+#include "esr_static.h"
 
 #endif
 
@@ -1,6 +1,11 @@
 #ifndef _ESR_CONF_h
 #define _ESR_CONF_h
 
+/*
+* RAM costs below are for AVR (2-byte pointers). esr::log_memory_usage() writes the total, 
+* the build fails if it exceeds __ESR_RAM_BUDGET
+*/
+
 /*
 * Define default max logging level
 */
@@ -9,10 +14,26 @@
 #endif
 
 /*
-* Define max thread slots count
+* Define max log modules count (see esr::log_module)
+*/
+#ifndef __ESR_LOG_MODULES
+#define __ESR_LOG_MODULES 8
+#endif
+
+/*
+* Define lowest log level compiled into the image: 0 - DEBUG, 1 - INFO, 2 - ERROR, 3 - none. 
+* ESR_LOG_* calls below it are removed along with their arguments and format strings
+*/
+#ifndef __ESR_LOG_THRESHOLD
+#define __ESR_LOG_THRESHOLD 0
+#endif
+
+/*
+* Define max thread slots count (11 bytes each, 9 without time budgets, plus a 13-byte thread timer). 
+* weatherhub firmware runs 6 threads
 */
 #ifndef __ESR_MAX_THREADS
-#define __ESR_MAX_THREADS 8
+#define __ESR_MAX_THREADS 6
 #endif
 
 /*
@@ -22,11 +43,151 @@
 #define __ESR_MAX_THREAD_QUEUE 4
 #endif
 
+/*
+* Define mailbox pool size: message queues of all threads share this amount of entries (up to 255, 5 bytes each). 
+* A new thread takes up to __ESR_MAX_THREAD_QUEUE entries, esr::set_thread_queue_size() resizes its share. 
+* The default pool is enough for all threads with full queues, shrink queues to make a smaller pool do
+*/
+#ifndef __ESR_MAILBOX_POOL
+#define __ESR_MAILBOX_POOL (__ESR_MAX_THREADS * __ESR_MAX_THREAD_QUEUE)
+#endif
+
+/*
+* Define max timers count in addition to one timer per thread (13 bytes each, the same as a thread timer). 
+* Timers are shared with delayed messages (esr::post_message_after(), esr::post_message_at())
+*/
+#ifndef __ESR_MAX_TIMERS
+#define __ESR_MAX_TIMERS 4
+#endif
+
+/*
+* Define max topics count (one thread mask each)
+*/
+#ifndef __ESR_MAX_TOPICS
+#define __ESR_MAX_TOPICS 4
+#endif
+
+/*
+* Define amount of message codes that might be coalesced (from 0 to __ESR_COALESCED_MESSAGES - 1)
+*/
+#ifndef __ESR_COALESCED_MESSAGES
+#define __ESR_COALESCED_MESSAGES 32
+#endif
+
+/*
+* Define interrupt message queue size (must be a power of 2, 6 bytes each)
+*/
+#ifndef __ESR_ISR_QUEUE
+#define __ESR_ISR_QUEUE 4
+#endif
+
+/*
+* Define deferred work queue size (esr::defer(), 6 bytes each)
+*/
+#ifndef __ESR_DEFERRED_WORK_QUEUE
+#define __ESR_DEFERRED_WORK_QUEUE 2
+#endif
+
+/*
+* Define cycle time budget of message draining in microseconds: threads with a drain limit above one message 
+* (esr::set_thread_drain()) receive extra messages only for this long within a scheduler loop iteration
+*/
+#ifndef __ESR_DRAIN_BUDGET
+#define __ESR_DRAIN_BUDGET 2000
+#endif
+
+/**
+* Enable tickless idle: esr::run_cycle() puts MCU to sleep (SLEEP_MODE_IDLE)
+* until the next interrupt if no thread is ready to run and no timer is due
+*/
+#define __ESR_ENABLE_TICKLESS_IDLE
+
+/**
+* Enable per-thread scheduler statistics: esr::get_thread_stats(), esr::get_kernel_stats(), esr::log_stats(). 
+* Costs 21 bytes per thread slot and 14 bytes of the scheduler loop. 
+* weatherhub firmware dumps them into the log every __ESR_THREAD_STATS_PERIOD
+*/
+#define __ESR_ENABLE_THREAD_STATS
+
+/*
+* Define period of statistics dump into log in milliseconds, 0 disables periodic dump
+*/
+#ifndef __ESR_THREAD_STATS_PERIOD
+#define __ESR_THREAD_STATS_PERIOD 60000
+#endif
+
+/**
+* Enable thread time budgets: thread function invocations longer than a budget are logged. 
+* Costs 2 bytes per thread slot
+*/
+#define __ESR_ENABLE_TIME_BUDGETS
+
+/*
+* Define default thread time budget in milliseconds
+*/
+#ifndef __ESR_DEFAULT_TIME_BUDGET
+#define __ESR_DEFAULT_TIME_BUDGET 100
+#endif
+
+/**
+* Enable AVR watchdog support: esr::watchdog_init(), esr::get_reset_culprit()
+*/
+#define __ESR_ENABLE_WATCHDOG
+
+/*
+* Define watchdog timeout (one of WDTO_* constants from avr/wdt.h)
+*/
+#ifndef __ESR_WATCHDOG_TIMEOUT
+#define __ESR_WATCHDOG_TIMEOUT WDTO_2S
+#endif
+
+/**
+* Enable kernel trace: scheduler events are recorded into a RAM ring buffer, see esr::trace_dump()
+*/
+// #define __ESR_ENABLE_TRACE
+
+/*
+* Define kernel trace buffer size in events (5 bytes each, 10 bytes of trace state)
+*/
+#ifndef __ESR_TRACE_BUFFER
+#define __ESR_TRACE_BUFFER 32
+#endif
+
 /**
 * Enable non-PROGMEM version of esr::log()
 */
 #define __ESR_ENABLE_NON_PROGMEM_FORMATTING
 
+/**
+* Enable binary logging: esr::log() with a PROGMEM format string writes a compact binary frame 
+* (format string address, level, timestamp and raw arguments) instead of text. 
+* Use extras/log/esr_log.py with the firmware ELF file to format the log on a PC
+*/
+// #define __ESR_ENABLE_BINARY_LOGGING
+
+/**
+* Enable log buffer: log messages are put into a RAM ring buffer and written into the log stream 
+* by deferred work (esr::defer()) and by the scheduler loop as the stream has room, so esr::log() doesn't wait for the UART 
+* while the buffer has room. A message longer than the buffer is dropped, a stats line takes up to ~125 bytes. 
+* The log stream must implement availableForWrite() (HardwareSerial does). 
+* Costs __ESR_LOG_BUFFER + 14 bytes
+*/
+#define __ESR_ENABLE_LOG_BUFFER
+
+/*
+* Define log buffer size in bytes (up to 255)
+*/
+#ifndef __ESR_LOG_BUFFER
+#define __ESR_LOG_BUFFER 128
+#endif
+
+/*
+* Define log buffer overflow policy: esr::LOG_BLOCK, esr::LOG_DROP_NEWEST or esr::LOG_DROP_OLDEST
+*/
+#ifndef __ESR_LOG_OVERFLOW
+#define __ESR_LOG_OVERFLOW esr::LOG_BLOCK
+#endif
+
 /**
 * Enable kernel logging via esr::log_d()
 */
@@ -37,4 +198,12 @@
 */
 // #define __ESR_ENABLE_ERROR_FORMATTING
 
+/*
+* Define max kernel RAM in bytes, the build fails if the configuration above takes more (see esr::log_memory_usage()). 
+* The configuration above takes ~629 bytes, 192 of them are thread slots with statistics and 128 the log buffer
+*/
+#ifndef __ESR_RAM_BUDGET
+#define __ESR_RAM_BUDGET 640
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef _ESR_COROUTINE_h
+#define _ESR_COROUTINE_h
+
+#include "esr_kernel.h"
+
+/*
+* Stackless coroutines for thread functions:
+* ==========================================
+* A coroutine is a piece of a thread function enclosed into ESR_BEGIN() and ESR_END().
+* ESR_AWAIT() returns control to the scheduler loop and resumes execution at the same point
+* on the next thread invocation once its condition is true.
+*
+*	esr::coroutine state;
+*
+*	void thread_func(esr::message msg, esr::message_param param)
+*	{
+*		ESR_BEGIN(state, msg);
+*		uart.print('?');
+*		ESR_AWAIT(uart.available() > 0);
+*		handle_response(uart.read());
+*		ESR_AWAIT_MS(1000);
+*		ESR_END();
+*	}
+*
+* Limitations:
+*  * local variables are not preserved across ESR_AWAIT(), use global or static ones instead;
+*  * ESR_AWAIT() can't be used inside of a switch statement;
+*  * only one ESR_AWAIT() is allowed per source line.
+*/
+
+namespace esr
+{
+	/**
+	* Coroutine state: a resume point (a source line number), zero means the beginning of a coroutine
+	*/
+	typedef uint16_t coroutine;
+}
+
+/**
+* Starts a coroutine body
+* @param co coroutine state (esr::coroutine variable)
+* @param msg message code the thread has been invoked with
+*/
+#define ESR_BEGIN(co, msg) \
+	esr::coroutine& __esr_co = (co); \
+	const esr::message __esr_msg = (msg); \
+	(void)__esr_msg; \
+	switch(__esr_co) { case 0:
+
+/**
+* Returns control to the scheduler loop, execution is resumed on the next thread invocation
+*/
+#define ESR_YIELD() \
+	do { __esr_co = __LINE__; return; case __LINE__: ; } while(0)
+
+/**
+* Returns control to the scheduler loop until the condition is true.
+* The condition is checked on each thread invocation
+* @param cond condition
+*/
+#define ESR_AWAIT(cond) \
+	do { __esr_co = __LINE__; case __LINE__: if(!(cond)) return; } while(0)
+
+/**
+* Returns control to the scheduler loop for the specified amount of milliseconds.
+* Uses a thread timer (as a one-shot timer), other messages don't resume the coroutine
+* @param ms delay in milliseconds
+*/
+#define ESR_AWAIT_MS(ms) \
+	do { \
+		esr::set_thread_flag(esr::THREAD_CURRENT, esr::THREAD_REPEAT_TIMER, false); \
+		esr::set_thread_flag(esr::THREAD_CURRENT, esr::THREAD_IMMEDIATE_TIMER, false); \
+		esr::set_timer_ms(esr::THREAD_CURRENT, (ms)); \
+		__esr_co = __LINE__; \
+		return; \
+	case __LINE__: \
+		if(__esr_msg != esr::MSG_TIMER) return; \
+	} while(0)
+
+/**
+* Ends a coroutine body. The next thread invocation will start the coroutine from the beginning
+*/
+#define ESR_END() \
+	} __esr_co = 0
+
+#endif
@@ -16,6 +16,14 @@ namespace res
 	PROGMEM char E_NOT_IN_SCHEDULER[] = "E_NOT_IN_SCHEDULER";
 	PROGMEM char E_LOG_CONFIGURATION_IS_INCORRECT[] = "E_LOG_CONFIGURATION_IS_INCORRECT";	
 	PROGMEM char E_INCORRECT_FORMAT[] = "E_INCORRECT_FORMAT";	
+	PROGMEM char E_WRONG_QUEUE_SIZE[] = "E_WRONG_QUEUE_SIZE";
+	PROGMEM char E_WRONG_PRIORITY[] = "E_WRONG_PRIORITY";
+	PROGMEM char E_WRONG_TOPIC[] = "E_WRONG_TOPIC";
+	PROGMEM char E_NO_RESET_CULPRIT[] = "E_NO_RESET_CULPRIT";
+	PROGMEM char E_NO_FREE_TIMERS[] = "E_NO_FREE_TIMERS";
+	PROGMEM char E_WRONG_TIMER[] = "E_WRONG_TIMER";
+	PROGMEM char E_WORK_QUEUE_IS_FULL[] = "E_WORK_QUEUE_IS_FULL";
+	PROGMEM char E_WRONG_LOG_MODULE[] = "E_WRONG_LOG_MODULE";
 }
 
 #define _CASE(name) case esr::name: message = reinterpret_cast<const __FlashStringHelper*>(res::name); break;
@@ -42,6 +50,14 @@ const __FlashStringHelper* esr::get_error_name(esr::error e)
 		_CASE(E_NOT_IN_SCHEDULER);		
 		_CASE(E_LOG_CONFIGURATION_IS_INCORRECT);
 		_CASE(E_INCORRECT_FORMAT);
+		_CASE(E_WRONG_QUEUE_SIZE);
+		_CASE(E_WRONG_PRIORITY);
+		_CASE(E_WRONG_TOPIC);
+		_CASE(E_NO_RESET_CULPRIT);
+		_CASE(E_NO_FREE_TIMERS);
+		_CASE(E_WRONG_TIMER);
+		_CASE(E_WORK_QUEUE_IS_FULL);
+		_CASE(E_WRONG_LOG_MODULE);
 
 	default:
 		message = reinterpret_cast<const __FlashStringHelper*>(res::E_UNKNOWN);
@@ -58,7 +74,7 @@ const __FlashStringHelper* esr::get_error_name(esr::error e)
 */
 void esr::format_error(char* buffer, esr::error e)
 {
-	uint16_t message = reinterpret_cast<uint16_t>(esr::get_error_name(e));
+	const char* message = reinterpret_cast<const char*>(esr::get_error_name(e));
 
 	// Copy message into buffer
 	uint8_t i = 0;
@@ -101,6 +117,48 @@ const __FlashStringHelper* get_function_name(esr::function_name function)
 		return F("clear_timer");
 	case esr::FUNC_GET_CURRENT_THREAD_ID:
 		return F("get_current_thread_id");
+	case esr::FUNC_SET_THREAD_QUEUE_SIZE:
+		return F("set_thread_queue_size");
+	case esr::FUNC_NEXT_DEADLINE:
+		return F("next_deadline");
+	case esr::FUNC_SET_THREAD_PRIORITY:
+		return F("set_thread_priority");
+	case esr::FUNC_POST_MESSAGE_FROM_ISR:
+		return F("post_message_from_isr");
+	case esr::FUNC_SUBSCRIBE:
+		return F("subscribe");
+	case esr::FUNC_UNSUBSCRIBE:
+		return F("unsubscribe");
+	case esr::FUNC_PUBLISH:
+		return F("publish");
+	case esr::FUNC_GET_THREAD_STATS:
+		return F("get_thread_stats");
+	case esr::FUNC_SET_THREAD_TIME_BUDGET:
+		return F("set_thread_time_budget");
+	case esr::FUNC_GET_RESET_CULPRIT:
+		return F("get_reset_culprit");
+	case esr::FUNC_SET_MESSAGE_COALESCING:
+		return F("set_message_coalescing");
+	case esr::FUNC_CREATE_TIMER:
+		return F("create_timer");
+	case esr::FUNC_START_TIMER:
+		return F("start_timer");
+	case esr::FUNC_STOP_TIMER:
+		return F("stop_timer");
+	case esr::FUNC_DELETE_TIMER:
+		return F("delete_timer");
+	case esr::FUNC_POST_MESSAGE_AFTER:
+		return F("post_message_after");
+	case esr::FUNC_POST_MESSAGE_AT:
+		return F("post_message_at");
+	case esr::FUNC_CANCEL_MESSAGE:
+		return F("cancel_message");
+	case esr::FUNC_DEFER:
+		return F("defer");
+	case esr::FUNC_SET_THREAD_DRAIN:
+		return F("set_thread_drain");
+	case esr::FUNC_SET_LOG_LEVEL:
+		return F("set_log_level");
 	default:
 		return F("<none>");
 	}
@@ -67,7 +67,47 @@ namespace esr
 		/**
 		* Incorrect format string
 		*/
-		E_INCORRECT_FORMAT
+		E_INCORRECT_FORMAT,
+
+		/**
+		* Wrong message queue size has been specified.
+		*/
+		E_WRONG_QUEUE_SIZE,
+
+		/**
+		* Wrong thread priority has been specified.
+		*/
+		E_WRONG_PRIORITY,
+
+		/**
+		* Wrong topic identifier has been specified.
+		*/
+		E_WRONG_TOPIC,
+
+		/**
+		* The last reset has not been caused by a hung thread.
+		*/
+		E_NO_RESET_CULPRIT,
+
+		/**
+		* Unable to create a new timer. All timers are taken.
+		*/
+		E_NO_FREE_TIMERS,
+
+		/**
+		* Wrong timer identifier has been specified.
+		*/
+		E_WRONG_TIMER,
+
+		/**
+		* Unable to defer a work item. Deferred work queue is full.
+		*/
+		E_WORK_QUEUE_IS_FULL,
+
+		/**
+		* Wrong log module identifier has been specified.
+		*/
+		E_WRONG_LOG_MODULE
 	};
 
 	/**
@@ -107,7 +147,28 @@ namespace esr
 		FUNC_SET_TIMER_MS,
 		FUNC_CHANGE_TIMER_MS,
 		FUNC_CLEAR_TIMER,
-		FUNC_GET_CURRENT_THREAD_ID
+		FUNC_GET_CURRENT_THREAD_ID,
+		FUNC_SET_THREAD_QUEUE_SIZE,
+		FUNC_NEXT_DEADLINE,
+		FUNC_SET_THREAD_PRIORITY,
+		FUNC_POST_MESSAGE_FROM_ISR,
+		FUNC_SUBSCRIBE,
+		FUNC_UNSUBSCRIBE,
+		FUNC_PUBLISH,
+		FUNC_GET_THREAD_STATS,
+		FUNC_SET_THREAD_TIME_BUDGET,
+		FUNC_GET_RESET_CULPRIT,
+		FUNC_SET_MESSAGE_COALESCING,
+		FUNC_CREATE_TIMER,
+		FUNC_START_TIMER,
+		FUNC_STOP_TIMER,
+		FUNC_DELETE_TIMER,
+		FUNC_POST_MESSAGE_AFTER,
+		FUNC_POST_MESSAGE_AT,
+		FUNC_CANCEL_MESSAGE,
+		FUNC_DEFER,
+		FUNC_SET_THREAD_DRAIN,
+		FUNC_SET_LOG_LEVEL
 	};
 
 	/**
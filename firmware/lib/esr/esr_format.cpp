@@ -0,0 +1,327 @@
+#include "esr_format.h"
+
+/**
+* Max amount of decimal digits of a 32-bit number
+*/
+const uint8_t MAX_DIGITS = 10;
+
+/**
+* Powers of ten of all digits but the last one, from 10^9 down to 10^1
+*/
+const uint32_t POWERS_OF_10[MAX_DIGITS - 1] PROGMEM =
+{
+	1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10
+};
+
+/**
+* Position of 10^4 in POWERS_OF_10, digits above it are zeros in 16-bit values
+*/
+const uint8_t FIRST_16BIT_POWER = 5;
+
+/**
+* Writes decimal digits of a value starting from the specified power of ten
+* @param buffer digits buffer
+* @param count amount of digits already in the buffer
+* @param value value, less than 10 times the starting power
+* @param power index of the starting power in POWERS_OF_10
+* @param min_digits min amount of digits, missing ones are leading zeros
+* @return amount of digits in the buffer
+*/
+template<typename T> uint8_t write_digits(char* buffer, uint8_t count, T value, uint8_t power, uint8_t min_digits)
+{
+	for(; power < MAX_DIGITS - 1; ++power)
+	{
+		const T p = static_cast<T>(pgm_read_dword(&POWERS_OF_10[power]));
+
+		char digit = '0';
+		while(value >= p)
+		{
+			value -= p;
+			++digit;
+		}
+
+		// Skip leading zeros
+		if(digit != '0' || count > 0 || MAX_DIGITS - power <= min_digits)
+		{
+			buffer[count++] = digit;
+		}
+	}
+
+	buffer[count++] = static_cast<char>('0' + value);
+	return count;
+}
+
+/**
+* Writes decimal digits of a value without division
+* @param buffer digits buffer, at least MAX_DIGITS characters
+* @param value value
+* @param min_digits min amount of digits, missing ones are leading zeros
+* @return amount of digits
+*/
+uint8_t write_digits(char* buffer, uint32_t value, uint8_t min_digits)
+{
+	if(value > 0xFFFF)
+	{
+		return write_digits<uint32_t>(buffer, 0, value, 0, min_digits);
+	}
+
+	// Most values fit into 16 bits, 16-bit subtractions are cheaper
+	uint8_t count = 0;
+	for(uint8_t power = 0; power < FIRST_16BIT_POWER; ++power)
+	{
+		if(MAX_DIGITS - power <= min_digits)
+		{
+			buffer[count++] = '0';
+		}
+	}
+
+	return write_digits<uint16_t>(buffer, count, static_cast<uint16_t>(value), FIRST_16BIT_POWER, min_digits);
+}
+
+/**
+* Writes digits of a number with sign, padding and decimal point
+* @param buffer text buffer
+* @param sign sign character, 0 if none
+* @param digits digits of the absolute value, the last decimals of them go after the decimal point
+* @param count amount of digits, more than decimals
+* @param decimals amount of digits after the decimal point
+* @param width min text width
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t format_digits(char* buffer, char sign, const char* digits, uint8_t count, uint8_t decimals, uint8_t width, uint8_t flags)
+{
+	uint8_t length = count;
+	if(decimals > 0)
+	{
+		++length;
+	}
+
+	if(sign != 0)
+	{
+		++length;
+	}
+
+	char* p = buffer;
+	const bool sign_first = (flags & (esr::NUMBER_ZERO_PAD | esr::NUMBER_SIGN_FIRST)) != 0;
+
+	if(sign != 0 && sign_first)
+	{
+		*p++ = sign;
+	}
+
+	const char padding = (flags & esr::NUMBER_ZERO_PAD) != 0 ? '0' : ' ';
+	for(; length < width; ++length)
+	{
+		*p++ = padding;
+	}
+
+	if(sign != 0 && !sign_first)
+	{
+		*p++ = sign;
+	}
+
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		if(i == count - decimals)
+		{
+			*p++ = '.';
+		}
+
+		*p++ = digits[i];
+	}
+
+	*p = 0;
+	return static_cast<uint8_t>(p - buffer);
+}
+
+/**
+* Writes a number with sign, padding and decimal point
+* @param buffer text buffer
+* @param sign sign character, 0 if none
+* @param magnitude absolute value multiplied by 10^decimals
+* @param decimals amount of digits after the decimal point
+* @param width min text width
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t format_number(char* buffer, char sign, uint32_t magnitude, uint8_t decimals, uint8_t width, uint8_t flags)
+{
+	char digits[MAX_DIGITS];
+	uint8_t count = write_digits(digits, magnitude, decimals + 1);
+	return format_digits(buffer, sign, digits, count, decimals, width, flags);
+}
+
+/**
+* Copies a PROGMEM string into a buffer, padded with spaces on the left
+* @param buffer text buffer
+* @param text PROGMEM string
+* @param length text length
+* @param width min text width
+* @return text length
+*/
+uint8_t copy_text(char* buffer, const __FlashStringHelper* text, uint8_t length, uint8_t width)
+{
+	char* p = buffer;
+	for(; length < width; --width)
+	{
+		*p++ = ' ';
+	}
+
+	const char* s = reinterpret_cast<const char*>(text);
+	while((*p = static_cast<char>(pgm_read_byte(s))) != 0)
+	{
+		++p;
+		++s;
+	}
+
+	return static_cast<uint8_t>(p - buffer);
+}
+
+/**
+* Formats an unsigned integer
+* @param buffer text buffer
+* @param value value
+* @param width min text width, padded on the left
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t esr::format_uint(char* buffer, uint32_t value, uint8_t width, uint8_t flags)
+{
+	const char sign = (flags & esr::NUMBER_PLUS) != 0 ? '+' : 0;
+	return format_number(buffer, sign, value, 0, width, flags);
+}
+
+/**
+* Formats a signed integer
+* @param buffer text buffer
+* @param value value
+* @param width min text width, padded on the left
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t esr::format_int(char* buffer, int32_t value, uint8_t width, uint8_t flags)
+{
+	return esr::format_fixed(buffer, value, 0, width, flags);
+}
+
+/**
+* Formats a fixed-point number
+* @param buffer text buffer
+* @param value value multiplied by 10^decimals
+* @param decimals amount of digits after the decimal point
+* @param width min text width, padded on the left
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t esr::format_fixed(char* buffer, int32_t value, uint8_t decimals, uint8_t width, uint8_t flags)
+{
+	if(decimals > esr::MAX_DECIMALS)
+	{
+		decimals = esr::MAX_DECIMALS;
+	}
+
+	char sign = (flags & esr::NUMBER_PLUS) != 0 ? '+' : 0;
+	uint32_t magnitude = static_cast<uint32_t>(value);
+	if(value < 0)
+	{
+		sign = '-';
+		magnitude = 0 - magnitude;
+	}
+
+	return format_number(buffer, sign, magnitude, decimals, width, flags);
+}
+
+/**
+* Largest float below 2^32, Print::print(float) writes "ovf" beyond it
+*/
+const float MAX_FLOAT_INTEGER = 4294967040.0;
+
+/**
+* 2^23, floats hold every multiple of 0.5 up to it exactly, so rounding of a scaled value up to it is exact
+*/
+const float MAX_EXACT_SCALED_FLOAT = 8388608.0;
+
+/**
+* Formats a floating-point number rounded to the specified amount of decimals
+* @param buffer text buffer
+* @param value value
+* @param decimals amount of digits after the decimal point
+* @param width min text width, padded on the left
+* @param flags number_flags combination
+* @return text length
+*/
+uint8_t esr::format_float(char* buffer, float value, uint8_t decimals, uint8_t width, uint8_t flags)
+{
+	if(value != value)
+	{
+		return copy_text(buffer, F("nan"), 3, width);
+	}
+
+	float magnitude = value < 0 ? -value : value;
+	if(magnitude > MAX_FLOAT_INTEGER)
+	{
+		// Infinity is beyond any float
+		if(magnitude > 3.4028235e38f)
+		{
+			return copy_text(buffer, F("inf"), 3, width);
+		}
+
+		return copy_text(buffer, F("ovf"), 3, width);
+	}
+
+	if(decimals > esr::MAX_DECIMALS)
+	{
+		decimals = esr::MAX_DECIMALS;
+	}
+
+	float scaled = magnitude;
+	for(uint8_t i = 0; i < decimals; ++i)
+	{
+		scaled *= 10;
+	}
+
+	scaled += 0.5;
+
+	char digits[MAX_DIGITS + esr::MAX_DECIMALS];
+	uint8_t count;
+	bool zero = false;
+	if(scaled <= MAX_EXACT_SCALED_FLOAT)
+	{
+		const uint32_t scaled_magnitude = static_cast<uint32_t>(scaled);
+		count = write_digits(digits, scaled_magnitude, decimals + 1);
+		zero = scaled_magnitude == 0;
+	}
+	else
+	{
+		// The scaled value would lose its lower digits: the integer part and the decimals go separately, 
+		// rounded the same way as Print::print(float) does
+		float rounding = 0.5;
+		for(uint8_t i = 0; i < decimals; ++i)
+		{
+			rounding *= 0.1f;
+		}
+
+		magnitude += rounding;
+		const uint32_t integer = static_cast<uint32_t>(magnitude);
+		float remainder = magnitude - integer;
+
+		count = write_digits(digits, integer, 1);
+		for(uint8_t i = 0; i < decimals; ++i)
+		{
+			remainder *= 10;
+			const uint8_t digit = static_cast<uint8_t>(remainder);
+			digits[count++] = static_cast<char>('0' + digit);
+			remainder -= digit;
+		}
+	}
+
+	// A value rounded to zero has no sign: -0.001 is "0.0", not "-0.0"
+	char sign = (flags & esr::NUMBER_PLUS) != 0 ? '+' : 0;
+	if(value < 0 && !zero)
+	{
+		sign = '-';
+	}
+
+	return format_digits(buffer, sign, digits, count, decimals, width, flags);
+}
@@ -0,0 +1,114 @@
+#ifndef _ESR_FORMAT_h
+#define _ESR_FORMAT_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+/*
+* Number formatting:
+* ==================
+* Numbers are converted to decimal text without division: each digit is found by subtracting powers of ten.
+* AVR has no hardware divider, a 32-bit division is a library routine of several hundred cycles, 
+* and print(float) or value % 10 loops take one per digit. AVR timings haven't been measured yet.
+* Fixed-point values are integers scaled by 10^decimals, ex. format_fixed(buffer, 235, 1) gives "23.5".
+* Functions write a null-terminated string and return its length. The buffer has to hold
+* max(width, NUMBER_BUFFER_SIZE - 1) characters and a terminating zero (FLOAT_BUFFER_SIZE for format_float()).
+*
+* Examples:
+*	format_fixed(buffer, -235, 1)							"-23.5"
+*	format_fixed(buffer, 235, 1, 6, NUMBER_PLUS | NUMBER_ZERO_PAD)	"+023.5"
+*	format_int(buffer, 23, 4, NUMBER_PLUS | NUMBER_SIGN_FIRST)		"+ 23"
+*	format_float(buffer, 23.45, 1)							"23.5"
+*/
+
+namespace esr
+{
+	/**
+	* Number formatting flags
+	*/
+	enum number_flags
+	{
+		/**
+		* Write '+' before non-negative numbers
+		*/
+		NUMBER_PLUS = 0x01,
+
+		/**
+		* Pad to width with zeros instead of spaces, the sign goes before zeros
+		*/
+		NUMBER_ZERO_PAD = 0x02,
+
+		/**
+		* Write the sign in the first column, before padding spaces
+		*/
+		NUMBER_SIGN_FIRST = 0x04
+	};
+
+	/**
+	* Buffer size enough for any number without width: a sign, 10 digits, a decimal point and a terminating zero
+	*/
+	const uint8_t NUMBER_BUFFER_SIZE = 13;
+
+	/**
+	* Buffer size enough for any floating-point number without width: a sign, 10 digits, a decimal point, 
+	* MAX_DECIMALS digits and a terminating zero
+	*/
+	const uint8_t FLOAT_BUFFER_SIZE = 22;
+
+	/**
+	* Max amount of decimals of fixed-point and floating-point numbers
+	*/
+	const uint8_t MAX_DECIMALS = 9;
+
+	/**
+	* Formats an unsigned integer
+	* @param buffer text buffer
+	* @param value value
+	* @param width min text width, padded on the left
+	* @param flags number_flags combination
+	* @return text length
+	*/
+	uint8_t format_uint(char* buffer, uint32_t value, uint8_t width = 0, uint8_t flags = 0);
+
+	/**
+	* Formats a signed integer
+	* @param buffer text buffer
+	* @param value value
+	* @param width min text width, padded on the left
+	* @param flags number_flags combination
+	* @return text length
+	*/
+	uint8_t format_int(char* buffer, int32_t value, uint8_t width = 0, uint8_t flags = 0);
+
+	/**
+	* Formats a fixed-point number
+	* @param buffer text buffer
+	* @param value value multiplied by 10^decimals
+	* @param decimals amount of digits after the decimal point (up to MAX_DECIMALS)
+	* @param width min text width, padded on the left
+	* @param flags number_flags combination
+	* @return text length
+	*/
+	uint8_t format_fixed(char* buffer, int32_t value, uint8_t decimals, uint8_t width = 0, uint8_t flags = 0);
+
+	/**
+	* Formats a floating-point number rounded to the specified amount of decimals, the same text as 
+	* Print::print(float) writes: "nan" for NaN, "inf" for infinity and "ovf" for values beyond 4294967040, 
+	* all three padded to width with spaces. Unlike Print, a negative value rounded to zero is written without the sign 
+	* and halves are rounded away from zero while the value multiplied by 10^decimals is below 2^23 
+	* (Print rounds in float arithmetic, ex. 177879.75 with 1 decimal gives "177879.7"). 
+	* The buffer has to hold max(width, FLOAT_BUFFER_SIZE - 1) characters and a terminating zero
+	* @param buffer text buffer
+	* @param value value
+	* @param decimals amount of digits after the decimal point (up to MAX_DECIMALS)
+	* @param width min text width, padded on the left
+	* @param flags number_flags combination
+	* @return text length
+	*/
+	uint8_t format_float(char* buffer, float value, uint8_t decimals, uint8_t width = 0, uint8_t flags = 0);
+}
+
+#endif
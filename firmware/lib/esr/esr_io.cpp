@@ -1,8 +1,14 @@
 #include "esr_io.h"
+#include "esr_format.h"
 
 Print* _log_stream = NULL;
 esr::log_level _max_log_level = esr::LOG_DISABLED;
 
+/**
+* Lowest allowed log levels of modules
+*/
+uint8_t _module_log_levels[esr::LOG_MODULES];
+
 /**
 * Data type for format placeholder
 */
@@ -48,6 +54,366 @@ struct format_placeholder
 	dataformat format;
 };
 
+#ifdef __ESR_ENABLE_LOG_BUFFER
+
+#include "esr_kernel.h"
+
+#if __ESR_LOG_BUFFER > 255
+#error __ESR_LOG_BUFFER must not exceed 255 bytes
+#endif
+
+/**
+* Log message ring buffer. Each message is stored with a length byte ahead of it, 
+* so whole messages are dropped on overflow and a message is never written into the target stream partially
+*/
+class log_buffer : public Print
+{
+public:
+	/**
+	* Stream messages are written into
+	*/
+	Print* target;
+
+	log_buffer() : target(NULL), _head(0), _used(0), _message(0), _sending(0), _dropping(false), _dropped(0)
+	{
+	}
+
+	using Print::write;
+
+	/**
+	* Puts a byte of the current message, starts a new message if there is none
+	* @param c byte
+	* @return 1, a byte of a dropped message counts as written too
+	*/
+	size_t write(uint8_t c)
+	{
+		if(_dropping)
+		{
+			return 1;
+		}
+
+		if(_message == 0)
+		{
+			begin_message();
+			if(_dropping)
+			{
+				return 1;
+			}
+		}
+
+		// The length byte limits message size
+		if(_message == 0xFF || !reserve())
+		{
+			drop_message();
+			return 1;
+		}
+
+		_data[get_tail()] = c;
+		++_used;
+		++_message;
+
+		return 1;
+	}
+
+	/**
+	* Starts a message, reserves its length byte
+	*/
+	void begin_message()
+	{
+		// Commit a message left unfinished (ex. format error)
+		end_message();
+
+		if(!reserve())
+		{
+			_dropping = true;
+			++_dropped;
+			return;
+		}
+
+		++_used;
+		_message = 1;
+	}
+
+	/**
+	* Completes the current message and schedules writing it into the target stream
+	*/
+	void end_message()
+	{
+		if(_dropping)
+		{
+			_dropping = false;
+			return;
+		}
+
+		if(_message == 0)
+		{
+			return;
+		}
+
+		uint16_t position = _head + _used - _message;
+		_data[position >= __ESR_LOG_BUFFER ? position - __ESR_LOG_BUFFER : position] = _message - 1;
+		_message = 0;
+
+		schedule_drain();
+	}
+
+	/**
+	* Writes complete messages into the target stream as long as it takes bytes without waiting
+	* @return true if there is nothing left to write
+	*/
+	bool drain()
+	{
+		int room = target->availableForWrite();
+
+		while(_used > _message)
+		{
+			if(_sending == 0)
+			{
+				// Take length of the next message
+				_sending = _data[_head];
+				advance(1);
+				continue;
+			}
+
+			if(room <= 0)
+			{
+				return false;
+			}
+
+			target->write(_data[_head]);
+			advance(1);
+			--_sending;
+			--room;
+		}
+
+		return true;
+	}
+
+	/**
+	* Gets amount of dropped messages
+	* @return amount of dropped messages
+	*/
+	uint16_t get_dropped()
+	{
+		return _dropped;
+	}
+
+private:
+	uint8_t _data[__ESR_LOG_BUFFER];
+
+	/**
+	* Position of the oldest byte
+	*/
+	uint8_t _head;
+
+	/**
+	* Amount of bytes in the buffer, including the current message
+	*/
+	uint8_t _used;
+
+	/**
+	* Amount of bytes of the current message including its length byte, 0 if there is no current message
+	*/
+	uint8_t _message;
+
+	/**
+	* Amount of bytes of the message at the head left to write, 0 if the head is a length byte
+	*/
+	uint8_t _sending;
+
+	/**
+	* Whether the rest of the current message is being dropped
+	*/
+	bool _dropping;
+
+	/**
+	* Amount of dropped messages
+	*/
+	uint16_t _dropped;
+
+	/**
+	* Gets position of the first free byte
+	* @return position
+	*/
+	uint8_t get_tail()
+	{
+		uint16_t position = _head + _used;
+		return position >= __ESR_LOG_BUFFER ? position - __ESR_LOG_BUFFER : position;
+	}
+
+	/**
+	* Frees bytes at the head
+	* @param size amount of bytes
+	*/
+	void advance(uint8_t size)
+	{
+		uint16_t position = _head + size;
+		_head = position >= __ESR_LOG_BUFFER ? position - __ESR_LOG_BUFFER : position;
+		_used -= size;
+	}
+
+	/**
+	* Makes room for a byte according to the overflow policy
+	* @return true if there is room
+	*/
+	bool reserve()
+	{
+		while(_used == __ESR_LOG_BUFFER)
+		{
+			// The current message is longer than the buffer
+			if(_used == _message)
+			{
+				return false;
+			}
+
+			if(__ESR_LOG_OVERFLOW == esr::LOG_BLOCK)
+			{
+				send_head();
+				continue;
+			}
+
+			// A partially written message can't be dropped
+			if(__ESR_LOG_OVERFLOW != esr::LOG_DROP_OLDEST || _sending != 0)
+			{
+				return false;
+			}
+
+			advance(_data[_head] + 1);
+			++_dropped;
+		}
+
+		return true;
+	}
+
+	/**
+	* Writes the rest of the message at the head into the target stream, waits until the stream takes it
+	*/
+	void send_head()
+	{
+		if(_sending == 0)
+		{
+			_sending = _data[_head];
+			advance(1);
+		}
+
+		for(; _sending > 0; --_sending)
+		{
+			target->write(_data[_head]);
+			advance(1);
+		}
+	}
+
+	/**
+	* Drops the current message
+	*/
+	void drop_message()
+	{
+		_used -= _message;
+		_message = 0;
+		_dropping = true;
+		++_dropped;
+	}
+
+	/**
+	* Schedules writing messages into the target stream
+	*/
+	void schedule_drain();
+};
+
+log_buffer _log_buffer;
+
+/**
+* Whether buffered messages wait for room in the target stream
+*/
+bool _log_drain_waiting;
+
+/**
+* Deferred work that writes buffered messages into the target stream
+* @param param unused
+*/
+void drain_log_buffer(esr::message_param param)
+{
+	(void)param;
+	esr::log_drain();
+}
+
+/**
+* Writes buffered log messages as long as the log stream takes bytes without waiting
+*/
+void esr::log_drain()
+{
+	// The rest is written once the stream has room, see esr::log_drain_ready()
+	_log_drain_waiting = !_log_buffer.drain();
+}
+
+/**
+* Checks if buffered log messages wait for room in the log stream and the stream has room now
+* @return true if the stream takes bytes again
+*/
+bool esr::log_drain_ready()
+{
+	return _log_drain_waiting && _log_buffer.target->availableForWrite() > 0;
+}
+
+void log_buffer::schedule_drain()
+{
+	// Without deferred work nothing writes the messages later
+	if(esr::defer(drain_log_buffer) != esr::E_OK)
+	{
+		while(!drain())
+		{
+		}
+	}
+}
+
+/**
+* Gets amount of log messages dropped because the log buffer was full
+* @return amount of dropped messages
+*/
+uint16_t esr::get_dropped_log_messages()
+{
+	return _log_buffer.get_dropped();
+}
+
+/**
+* Writes all buffered log messages into the log stream, waits until the stream takes them
+*/
+void esr::log_flush()
+{
+	if(_log_buffer.target == NULL)
+	{
+		return;
+	}
+
+	while(!_log_buffer.drain())
+	{
+	}
+
+	_log_drain_waiting = false;
+}
+
+#endif
+
+/**
+* Starts a log message
+*/
+inline void begin_log_message()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	_log_buffer.begin_message();
+#endif
+}
+
+/**
+* Completes a log message
+*/
+inline void end_log_message()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	_log_buffer.end_message();
+#endif
+}
+
 /**
 * Initializes serial logging
 * @param stream a destination stream (ex. Serial)
@@ -56,12 +422,66 @@ struct format_placeholder
 */
 esr::error esr::log_init(Print& stream, esr::log_level max_level)
 {
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	// Messages of the previous stream go into the new one
+	_log_buffer.target = &stream;
+	_log_stream = &_log_buffer;
+#else
 	_log_stream = &stream;
+#endif
 	_max_log_level = max_level;
 
 	return esr::E_OK;
 }
 
+/**
+* Sets lowest allowed log level of a module
+* @param module log module
+* @param level lowest allowed log level
+* @return error code
+*/
+esr::error esr::set_log_level(esr::log_module module, esr::log_level level)
+{
+	if(module >= esr::LOG_MODULES)
+	{
+		return esr::E_WRONG_LOG_MODULE;
+	}
+
+	_module_log_levels[module] = level;
+	return esr::E_OK;
+}
+
+/**
+* Gets lowest allowed log level of a module
+* @param module log module
+* @return log level
+*/
+esr::log_level esr::get_log_level(esr::log_module module)
+{
+	if(module >= esr::LOG_MODULES)
+	{
+		return esr::LOG_DISABLED;
+	}
+
+	return static_cast<esr::log_level>(_module_log_levels[module]);
+}
+
+/**
+* Checks whether a message passes both the global and the module log level
+* @param level logging level
+* @param module log module, messages of a wrong module are not filtered by module
+* @return true if the message is to be written
+*/
+inline bool is_log_enabled(esr::log_level level, esr::log_module module)
+{
+	if(_max_log_level > level)
+	{
+		return false;
+	}
+
+	return module >= esr::LOG_MODULES || _module_log_levels[module] <= level;
+}
+
 /**
 * Prints log level-based header
 * @param level log level
@@ -79,39 +499,43 @@ void print_log_header(esr::log_level level)
 	case esr::LOG_ERROR:
 		_log_stream->print(F("ERROR\t"));
 		break;
+	case esr::LOG_DISABLED:
+		// Not a message level, esr::log() filters such messages out
+		break;
 	}
 }
 
 template<typename T>
-const T get_argument(va_list& args)
+T get_argument(va_list& args)
 {
-	int value = va_arg(args, int);
-	return reinterpret_cast<T>(value);
+	// Pointers are passed as is
+	return va_arg(args, T);
 }
 
 template<>
-const bool get_argument(va_list& args)
+bool get_argument(va_list& args)
 {
 	int value = va_arg(args, int);
 	return static_cast<bool>(value);
 }
 
 template<>
-const int8_t get_argument(va_list& args)
+int8_t get_argument(va_list& args)
 {
 	int value = va_arg(args, int);
 	return static_cast<int8_t>(value);
 }
 
 template<>
-const int16_t get_argument(va_list& args)
+int16_t get_argument(va_list& args)
 {
-	int value = va_arg(args, long);
+	// int16_t is promoted to int
+	int value = va_arg(args, int);
 	return static_cast<int16_t>(value);
 }
 
 template<>
-const char get_argument(va_list& args)
+char get_argument(va_list& args)
 {
 	int value = va_arg(args, int);
 	return static_cast<char>(value);
@@ -230,7 +654,9 @@ print_placeholder_result print_format_placeholder(const char c, const char extra
 		// floating-point number
 		{
 			const float s = *get_argument<float*>(args);
-			_log_stream->print(s);
+			char text[esr::FLOAT_BUFFER_SIZE];
+			esr::format_float(text, s, 2);
+			_log_stream->print(text);
 		}
 		break;
 
@@ -306,6 +732,10 @@ print_placeholder_result print_format_placeholder(const char c, const char extra
 		}
 
 		return RESULT_TWO_CHARS;
+
+	default:
+		// Unknown placeholder
+		return RESULT_ERROR;
 	}
 
 	return RESULT_ONE_CHAR;
@@ -329,7 +759,7 @@ esr::error esr::log(esr::log_level level, const char* format, ...)
 	}
 
 	// Skip if log level is disabled
-	if(_max_log_level > level)
+	if(!is_log_enabled(level, esr::LOG_MODULE_DEFAULT))
 	{
 		return esr::E_OK;
 	}
@@ -337,11 +767,14 @@ esr::error esr::log(esr::log_level level, const char* format, ...)
 	va_list args;
 	va_start(args, format);
 
+	begin_log_message();
+
 	print_log_header(level);
 
 	// Print formatted message
+	bool success = true;
 	--format;
-	while(true)
+	while(success)
 	{
 		++format;
 		char c = *format;
@@ -360,7 +793,8 @@ esr::error esr::log(esr::log_level level, const char* format, ...)
 			switch(print_format_placeholder(c, e, args))
 			{
 			case RESULT_ERROR:
-				return false;
+				success = false;
+				break;
 
 			case RESULT_ONE_CHAR:
 				break;
@@ -378,8 +812,10 @@ esr::error esr::log(esr::log_level level, const char* format, ...)
 
 	_log_stream->println();
 
+	end_log_message();
+
 	va_end(args);
-	return esr::E_OK;
+	return success ? esr::E_OK : esr::E_INCORRECT_FORMAT;
 }
 
 #endif
@@ -392,9 +828,10 @@ esr::error esr::log(esr::log_level level, const char* format, ...)
 bool try_print(const __FlashStringHelper* format, va_list& args)
 {
 	// Print formatted message
-	uint16_t address = reinterpret_cast<uint16_t>(format);
+	bool success = true;
+	const char* address = reinterpret_cast<const char*>(format);
 	--address;
-	while(true)
+	while(success)
 	{
 		++address;
 		char c = pgm_read_byte(address);
@@ -413,7 +850,8 @@ bool try_print(const __FlashStringHelper* format, va_list& args)
 			switch(print_format_placeholder(c, e, args))
 			{
 			case RESULT_ERROR:
-				return false;
+				success = false;
+				break;
 
 			case RESULT_ONE_CHAR:
 				break;
@@ -430,17 +868,256 @@ bool try_print(const __FlashStringHelper* format, va_list& args)
 	}
 
 	_log_stream->println();
+	return success;
+}
+
+#ifdef __ESR_ENABLE_BINARY_LOGGING
+
+/**
+* Binary log frame marker. Log text is ASCII, so text and binary frames might share a stream
+*/
+const uint8_t LOG_FRAME_MARKER = 0xA5;
+
+/**
+* Maximum size of encoded arguments of a binary log frame
+*/
+const uint8_t LOG_FRAME_ARGS = 63;
+
+/**
+* Level of kernel log messages (esr::log_d()) in binary log frames
+*/
+const uint8_t LOG_FRAME_KERNEL = 3;
+
+/**
+* Flash address of a format string, it identifies the format string in a binary log frame
+*/
+#ifdef __AVR__
+typedef uint16_t log_address;
+#else
+typedef uintptr_t log_address;
+#endif
+
+/**
+* Binary log frame:
+*	marker		1 byte			LOG_FRAME_MARKER
+*	header		1 byte			level (bits 6..7), size of arguments (bits 0..5)
+*	format		2 bytes			format string address (pointer size on non-AVR platforms)
+*	time		4 bytes			millis()
+*	arguments	0..63 bytes		in order of placeholders, integers and floats are little-endian: 
+*								%c %b %ub %xb %e - 1 byte, %d %ud %xd - 2 bytes, %l %ul %xl %f - 4 bytes, 
+*								%ps - flash address (as format), %s - null-terminated characters
+*/
+struct log_frame
+{
+	uint8_t size;
+	uint8_t args[LOG_FRAME_ARGS];
+
+	/**
+	* Appends an argument value
+	* @param data argument value
+	* @param length value size
+	* @return false if the value doesn't fit
+	*/
+	bool put(const void* data, uint8_t length)
+	{
+		if(length > LOG_FRAME_ARGS - size)
+		{
+			return false;
+		}
+
+		memcpy(args + size, data, length);
+		size += length;
+		return true;
+	}
+
+	/**
+	* Appends a null-terminated string, the string is truncated if it doesn't fit
+	* @param s string
+	* @return false if there is no room even for the terminator
+	*/
+	bool put_string(const char* s)
+	{
+		while(*s != '\0' && size < LOG_FRAME_ARGS - 1)
+		{
+			args[size++] = *s++;
+		}
+
+		uint8_t terminator = '\0';
+		return put(&terminator, 1);
+	}
+};
+
+/**
+* Encodes format arguments into a binary log frame
+* @param format format string (flash memory)
+* @param args format arguments list
+* @param frame [out] log frame
+* @return false if the format string is incorrect or arguments don't fit into the frame
+*/
+bool try_encode(const __FlashStringHelper* format, va_list& args, log_frame& frame)
+{
+	const char* address = reinterpret_cast<const char*>(format);
+	while(true)
+	{
+		char c = pgm_read_byte(address);
+		++address;
+		if(c == '\0')
+		{
+			return true;
+		}
+
+		if(c != '%')
+		{
+			continue;
+		}
+
+		c = pgm_read_byte(address);
+		char extra = c != '\0' 
+			? pgm_read_byte(address + 1)
+			: '\0';
+
+		bool success = true;
+		switch(c)
+		{
+		case '\0':
+			// %\0
+			return true;
+
+		case '%':
+			break;
+
+		case 'c':
+			{
+				const char x = get_argument<char>(args);
+				success = frame.put(&x, sizeof(x));
+			}
+			break;
+
+		case 's':
+			success = frame.put_string(get_argument<char*>(args));
+			break;
+
+		case 'p':
+			if(extra != 's')
+			{
+				return false;
+			}
+
+			{
+				const log_address x = static_cast<log_address>(
+					reinterpret_cast<uintptr_t>(get_argument<__FlashStringHelper*>(args)));
+				success = frame.put(&x, sizeof(x));
+			}
+			++address;
+			break;
+
+		case 'e':
+		case 'b':
+			{
+				const int8_t x = get_argument<int8_t>(args);
+				success = frame.put(&x, sizeof(x));
+			}
+			break;
+
+		case 'd':
+			{
+				const int16_t x = get_argument<int16_t>(args);
+				success = frame.put(&x, sizeof(x));
+			}
+			break;
+
+		case 'l':
+			success = frame.put(get_argument<int32_t*>(args), sizeof(int32_t));
+			break;
+
+		case 'f':
+			success = frame.put(get_argument<float*>(args), sizeof(float));
+			break;
+
+		case 'u':
+		case 'x':
+			switch(extra)
+			{
+			case 'b':
+				{
+					const int8_t x = get_argument<int8_t>(args);
+					success = frame.put(&x, sizeof(x));
+				}
+				break;
+
+			case 'd':
+				{
+					const int16_t x = get_argument<int16_t>(args);
+					success = frame.put(&x, sizeof(x));
+				}
+				break;
+
+			case 'l':
+				success = frame.put(get_argument<uint32_t*>(args), sizeof(uint32_t));
+				break;
+
+			default:
+				return false;
+			}
+			++address;
+			break;
+
+		default:
+			// Unknown placeholder, the same as in text logs
+			return false;
+		}
+
+		if(!success)
+		{
+			return false;
+		}
+
+		// Skip placeholder code
+		++address;
+	}
+}
+
+/**
+* Writes a binary log frame into log stream
+* @param level log level (or LOG_FRAME_KERNEL)
+* @param format format string (flash memory)
+* @param args format arguments list
+* @return false if the format string is incorrect or arguments don't fit into the frame
+*/
+bool try_write_frame(uint8_t level, const __FlashStringHelper* format, va_list& args)
+{
+	log_frame frame;
+	frame.size = 0;
+	if(!try_encode(format, args, frame))
+	{
+		return false;
+	}
+
+	const log_address address = static_cast<log_address>(reinterpret_cast<uintptr_t>(format));
+	const uint32_t time = millis();
+
+	uint8_t header[2 + sizeof(address) + sizeof(time)];
+	header[0] = LOG_FRAME_MARKER;
+	header[1] = (level << 6) | frame.size;
+	memcpy(header + 2, &address, sizeof(address));
+	memcpy(header + 2 + sizeof(address), &time, sizeof(time));
+
+	_log_stream->write(header, sizeof(header));
+	_log_stream->write(frame.args, frame.size);
 	return true;
 }
 
+#endif
+
 /**
 * Prints a formatted message into log
 * @param level logging level
+* @param module log module
 * @param format format string (flash memory)
-* @param ... format arguments
+* @param args format arguments
 * @return error code
 */
-esr::error esr::log(esr::log_level level, const __FlashStringHelper* format, ...)
+esr::error try_log(esr::log_level level, esr::log_module module, const __FlashStringHelper* format, va_list& args)
 {
 	// Check if logging is set up
 	if(_log_stream == NULL)
@@ -449,22 +1126,63 @@ esr::error esr::log(esr::log_level level, const __FlashStringHelper* format, ...
 	}
 
 	// Skip if log level is disabled
-	if(_max_log_level > level)
+	if(!is_log_enabled(level, module))
 	{
 		return esr::E_OK;
 	}
 
-	va_list args;
-	va_start(args, format);
+	begin_log_message();
 
+#ifdef __ESR_ENABLE_BINARY_LOGGING
+	bool success = try_write_frame(level, format, args);
+#else
 	print_log_header(level);
 
 	bool success = try_print(format, args);
+#endif
+
+	end_log_message();
 
-	va_end(args);
 	return success ? esr::E_OK : esr::E_INCORRECT_FORMAT;
 }
 
+/**
+* Prints a formatted message into log
+* @param level logging level
+* @param format format string (flash memory)
+* @param ... format arguments
+* @return error code
+*/
+esr::error esr::log(esr::log_level level, const __FlashStringHelper* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	esr::error result = try_log(level, esr::LOG_MODULE_DEFAULT, format, args);
+
+	va_end(args);
+	return result;
+}
+
+/**
+* Prints a formatted message of a module into log
+* @param level logging level
+* @param module log module
+* @param format format string (flash memory)
+* @param ... format arguments
+* @return error code
+*/
+esr::error esr::log(esr::log_level level, esr::log_module module, const __FlashStringHelper* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	esr::error result = try_log(level, module, format, args);
+
+	va_end(args);
+	return result;
+}
+
 /**
 * An internal version of logging function. Might be disabled by defines
 * @param format format string (flash memory)
@@ -482,12 +1200,20 @@ void esr::log_d(const __FlashStringHelper* format, ...)
 
 	// Print message
 
-	_log_stream->print(F("KERNL\t"));
-
 	va_list args;
 	va_start(args, format);
 
+	begin_log_message();
+
+#ifdef __ESR_ENABLE_BINARY_LOGGING
+	try_write_frame(LOG_FRAME_KERNEL, format, args);
+#else
+	_log_stream->print(F("KERNL\t"));
+
 	try_print(format, args);
+#endif
+
+	end_log_message();
 
 	va_end(args);
 
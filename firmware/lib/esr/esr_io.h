@@ -29,6 +29,26 @@
 * %xb	const uint8_t				Hexadecimal 1-byte unsigned integer
 * %xd	const uint16_t				Hexadecimal 2-byte unsigned integer
 * %xl	const uint32_t*				Hexadecimal 4-byte unsigned integer
+*
+* Other placeholders stop formatting, esr::log() returns E_INCORRECT_FORMAT (both in text and binary logs).
+*
+* Binary logging:
+* ===============
+* If __ESR_ENABLE_BINARY_LOGGING is defined then messages with PROGMEM format strings are not formatted, 
+* a frame with the format string address, level, millis() and raw argument values is written instead.
+* extras/log/esr_log.py formats such a log on a PC using the firmware ELF file.
+* Messages with RAM format strings are always written as text.
+*
+* Log buffer:
+* ===========
+* If __ESR_ENABLE_LOG_BUFFER is defined then esr::log() puts messages into a RAM ring buffer and returns. 
+* Deferred work (esr::defer()) writes them into the log stream when the kernel has nothing else to do, 
+* only as many bytes as the stream takes without waiting. If the stream is full the rest waits without 
+* keeping the kernel busy: the scheduler loop writes it once the stream has room again (the UART interrupt 
+* wakes MCU up from tickless idle as bytes go out). When the buffer is full esr::log() either waits 
+* for the stream or drops messages as a whole (see __ESR_LOG_OVERFLOW), esr::get_dropped_log_messages() counts them. 
+* If the deferred work queue is full, messages are written synchronously. 
+* esr::log_stats() and esr::log_memory_usage() flush the buffer before each line, so dumps are never cut.
 */
 
 namespace esr
@@ -65,6 +85,44 @@ namespace esr
 	*/
 	const log_level MAX_LOG_LEVEL = __ESR_MAX_LOG_LEVEL;
 
+	/**
+	* Log buffer overflow policy
+	*/
+	enum log_overflow
+	{
+		/**
+		* A message that doesn't fit into the log buffer is dropped
+		*/
+		LOG_DROP_NEWEST,
+
+		/**
+		* The oldest messages are dropped to make room for a new one. 
+		* A message that is being written into the log stream is never dropped, the new one is dropped then
+		*/
+		LOG_DROP_OLDEST,
+
+		/**
+		* The oldest messages are written into the log stream synchronously to make room for a new one, 
+		* esr::log() waits for the stream then. No message is lost unless it is longer than the buffer
+		*/
+		LOG_BLOCK
+	};
+
+	/**
+	* Log module identifier. Modules are defined by application, each one has its own log level
+	*/
+	typedef uint8_t log_module;
+
+	/**
+	* Max log modules count
+	*/
+	const uint8_t LOG_MODULES = __ESR_LOG_MODULES;
+
+	/**
+	* Module of messages logged without a module identifier
+	*/
+	const log_module LOG_MODULE_DEFAULT = 0;
+
 	/**
 	* Initializes serial logging
 	* @param stream a destination stream (ex. Serial)
@@ -94,6 +152,60 @@ namespace esr
 	*/
 	error log(log_level level, const __FlashStringHelper* format, ...);
 
+	/**
+	* Prints a formatted message of a module into log
+	* @param level logging level
+	* @param module log module
+	* @param format format string (flash memory)
+	* @param ... format arguments
+	* @return error code
+	*/
+	error log(log_level level, log_module module, const __FlashStringHelper* format, ...);
+
+	/**
+	* Sets lowest allowed log level of a module. Messages also have to pass the level set by esr::log_init()
+	* @param module log module
+	* @param level lowest allowed log level, LOG_DISABLED mutes the module
+	* @return error code
+	*/
+	error set_log_level(log_module module, log_level level);
+
+	/**
+	* Gets lowest allowed log level of a module
+	* @param module log module
+	* @return log level, LOG_DISABLED if the module is wrong
+	*/
+	log_level get_log_level(log_module module);
+
+#ifdef __ESR_ENABLE_LOG_BUFFER
+
+	/**
+	* Gets amount of log messages dropped because the log buffer was full
+	* @return amount of dropped messages
+	*/
+	uint16_t get_dropped_log_messages();
+
+	/**
+	* Writes all buffered log messages into the log stream, waits until the stream takes them. 
+	* Buffered messages are written by deferred work, this function is for cases when the scheduler loop 
+	* doesn't run (ex. before a deliberate reset)
+	*/
+	void log_flush();
+
+	/**
+	* Checks if buffered log messages wait for room in the log stream and the stream has room now. 
+	* Waiting messages don't keep the scheduler loop busy, it calls esr::log_drain() once this is true
+	* @return true if the stream takes bytes again
+	*/
+	bool log_drain_ready();
+
+	/**
+	* Writes buffered log messages as long as the log stream takes bytes without waiting
+	*/
+	void log_drain();
+
+#endif
+
 	/**
 	* An internal version of logging function. Might be disabled by defines
 	* @param format format string (flash memory)
@@ -102,4 +214,33 @@ namespace esr
 	void log_d(const __FlashStringHelper* format, ...);
 }
 
+/*
+* Logging statements checked against __ESR_LOG_THRESHOLD at compile time:
+*
+*	ESR_LOG_DEBUG(F("APP\tstartup"));
+*	ESR_LOG_DEBUG(MODULE_GUI, F("GUI\tactive_sensor = %ps"), name);
+*
+* A statement below the threshold is kept only for type checking in a dead branch, 
+* the compiler drops it with its arguments and the format string
+*/
+#define __ESR_LOG_REMOVED(level, ...) do { if(false) { esr::log(level, __VA_ARGS__); } } while(false)
+
+#if __ESR_LOG_THRESHOLD <= 0
+#define ESR_LOG_DEBUG(...) esr::log(esr::LOG_DEBUG, __VA_ARGS__)
+#else
+#define ESR_LOG_DEBUG(...) __ESR_LOG_REMOVED(esr::LOG_DEBUG, __VA_ARGS__)
+#endif
+
+#if __ESR_LOG_THRESHOLD <= 1
+#define ESR_LOG_INFO(...) esr::log(esr::LOG_INFO, __VA_ARGS__)
+#else
+#define ESR_LOG_INFO(...) __ESR_LOG_REMOVED(esr::LOG_INFO, __VA_ARGS__)
+#endif
+
+#if __ESR_LOG_THRESHOLD <= 2
+#define ESR_LOG_ERROR(...) esr::log(esr::LOG_ERROR, __VA_ARGS__)
+#else
+#define ESR_LOG_ERROR(...) __ESR_LOG_REMOVED(esr::LOG_ERROR, __VA_ARGS__)
+#endif
+
 #endif
\ No newline at end of file
@@ -1,134 +1,1393 @@
 #include "esr_kernel.h"
 #include "esr_io.h"
 
+#if defined(__ESR_ENABLE_TICKLESS_IDLE) && defined(__AVR__)
+#include <avr/sleep.h>
+#include <avr/interrupt.h>
+#endif
+
+#if defined(__ESR_ENABLE_WATCHDOG) && defined(__AVR__)
+#include <avr/wdt.h>
+#endif
+
+#if __ESR_MAILBOX_POOL > 255
+#error __ESR_MAILBOX_POOL must not exceed 255
+#endif
+
+/**
+* Message queues of all threads. A thread takes queue_capacity entries starting from queue_base, 
+* queues are laid out in order of thread slots
+*/
+esr::message _mailbox_queue[esr::MAILBOX_POOL];
+esr::message_param _mailbox_params[esr::MAILBOX_POOL];
+
 struct thread_slot
 {
 	esr::thread_func func;
-	esr::thread_flags flags;
-	esr::message queue[esr::MAX_THREAD_QUEUE];
-	uint8_t queue_tail;
-	esr::timer_period period;
-	esr::timer_period last_invokation;
+	uint8_t flags;
+	esr::thread_priority priority;
+	uint8_t drain_limit;
+	uint8_t queue_base;
+	uint8_t queue_head;
+	uint8_t queue_count;
+	uint8_t queue_capacity;
+#ifdef __ESR_ENABLE_TIME_BUDGETS
+	uint16_t time_budget;
+#endif
+#ifdef __ESR_ENABLE_THREAD_STATS
+	esr::thread_stats stats;
+#endif
 
 	__inline__ bool has_flag(esr::thread_flags flag) const
 	{
 		return (flags & flag) != 0;
 	}
 
+	__inline__ bool queue_is_empty() const
+	{
+		return queue_count == 0;
+	}
+
+	__inline__ bool queue_is_full() const
+	{
+		return queue_count >= queue_capacity;
+	}
+
+	/**
+	* Puts a message at the tail of the ring buffer. The queue must not be full.
+	*/
+	__inline__ void enqueue(esr::message msg, esr::message_param param)
+	{
+		uint8_t tail = queue_head + queue_count;
+		if(tail >= queue_capacity)
+		{
+			tail -= queue_capacity;
+		}
+
+		_mailbox_queue[queue_base + tail] = msg;
+		_mailbox_params[queue_base + tail] = param;
+		++queue_count;
+	}
+
+	/**
+	* Looks for a pending message in the ring buffer
+	* @param msg message code
+	* @param index [out] mailbox pool index of the message
+	* @return true if the message is pending
+	*/
+	__inline__ bool find(esr::message msg, uint8_t& index) const
+	{
+		uint8_t i = queue_head;
+		for(uint8_t n = 0; n < queue_count; ++n)
+		{
+			if(_mailbox_queue[queue_base + i] == msg)
+			{
+				index = queue_base + i;
+				return true;
+			}
+
+			++i;
+			if(i >= queue_capacity)
+			{
+				i = 0;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	* Takes a message from the head of the ring buffer. The queue must not be empty.
+	*/
+	__inline__ esr::message dequeue(esr::message_param& param)
+	{
+		esr::message msg = _mailbox_queue[queue_base + queue_head];
+		param = _mailbox_params[queue_base + queue_head];
+
+		++queue_head;
+		if(queue_head >= queue_capacity)
+		{
+			queue_head = 0;
+		}
+
+		--queue_count;
+		return msg;
+	}
+
+	/**
+	* Rotates the ring buffer so pending messages start from the first entry
+	*/
+	void rewind()
+	{
+		if(queue_count == 0)
+		{
+			queue_head = 0;
+			return;
+		}
+
+		// Rotate by one entry at a time, queues are short
+		esr::message* queue = _mailbox_queue + queue_base;
+		esr::message_param* params = _mailbox_params + queue_base;
+		while(queue_head != 0)
+		{
+			esr::message msg = queue[0];
+			esr::message_param param = params[0];
+			for(uint8_t i = 1; i < queue_capacity; ++i)
+			{
+				queue[i - 1] = queue[i];
+				params[i - 1] = params[i];
+			}
+
+			queue[queue_capacity - 1] = msg;
+			params[queue_capacity - 1] = param;
+			--queue_head;
+		}
+	}
+
 	__inline__ void set_flag(esr::thread_flags flag)
 	{
-		flags = static_cast<esr::thread_flags>(flags | flag);
+		flags |= flag;
+	}
+
+	__inline__ void clear_flag(esr::thread_flags flag)
+	{
+		flags &= ~flag;
+	}
+};
+
+thread_slot _threads[esr::MAX_THREADS];
+bool _is_in_thread;
+esr::thread_id _current_thread_id;
+
+#if (__ESR_ISR_QUEUE & (__ESR_ISR_QUEUE - 1)) != 0
+#error __ESR_ISR_QUEUE must be a power of 2
+#endif
+
+/**
+* Message codes to be coalesced, one bit per message code
+*/
+uint8_t _coalesced_messages[(__ESR_COALESCED_MESSAGES + 7) / 8];
+
+/**
+* Checks if the message code is to be coalesced
+* @param msg message code
+* @return true if the message is to be coalesced
+*/
+__inline__ bool is_coalesced(esr::message msg)
+{
+	return msg < esr::MAX_COALESCED_MESSAGES && 
+		(_coalesced_messages[msg >> 3] & (1 << (msg & 0x07))) != 0;
+}
+
+/**
+* Subscribers of each topic
+*/
+esr::thread_mask _topics[esr::MAX_TOPICS];
+
+/**
+* Gets a bit of the thread in a thread mask
+* @param id thread identifier
+* @return thread mask with a single bit set
+*/
+__inline__ esr::thread_mask thread_bit(esr::thread_id id)
+{
+	return static_cast<esr::thread_mask>(1) << id;
+}
+
+/**
+* Alive threads with pending messages
+*/
+esr::thread_mask _pending_threads;
+
+/**
+* Alive threads with THREAD_IDLE_LOOP flag set
+*/
+esr::thread_mask _idle_threads;
+
+/**
+* Alive threads of each priority
+*/
+esr::thread_mask _priority_threads[esr::PRIORITY_HIGH + 1];
+
+/**
+* Gets the lowest thread identifier in a thread mask
+* @param mask non-empty thread mask
+* @return thread identifier
+*/
+__inline__ esr::thread_id first_thread(esr::thread_mask mask)
+{
+#if __ESR_MAX_THREADS <= 16
+	return static_cast<esr::thread_id>(__builtin_ctz(mask));
+#else
+	return static_cast<esr::thread_id>(__builtin_ctzl(mask));
+#endif
+}
+
+/**
+* A message posted from an interrupt service routine
+*/
+struct isr_message
+{
+	esr::thread_id id;
+	esr::message msg;
+	esr::message_param param;
+};
+
+/**
+* Single-producer single-consumer ring buffer of messages posted from ISRs.
+* _isr_tail is written by ISRs only, _isr_head is written by scheduler loop only.
+*/
+isr_message _isr_queue[__ESR_ISR_QUEUE];
+volatile uint8_t _isr_head;
+volatile uint8_t _isr_tail;
+
+/**
+* A deferred work item
+*/
+struct work_item
+{
+	esr::work_func func;
+	esr::message_param param;
+};
+
+/**
+* Ring buffer of deferred work items
+*/
+work_item _work_queue[esr::MAX_DEFERRED_WORK];
+uint8_t _work_head;
+uint8_t _work_count;
+
+/**
+* Prevents compiler from reordering memory accesses across this point
+*/
+#define ESR_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+
+/**
+* Time spent in thread functions since the last statistics reset, in microseconds
+*/
+uint32_t _busy_time;
+
+/**
+* Time of the last statistics reset (in terms of micros())
+*/
+uint32_t _stats_start;
+
+/**
+* Time of the last statistics dump (in terms of millis())
+*/
+esr::timer_period _stats_dump_time;
+
+/**
+* Amount of messages rejected by esr::post_message_from_isr(), written by ISRs only
+*/
+volatile uint16_t _dropped_isr_messages;
+
+#endif
+
+#ifdef __ESR_ENABLE_WATCHDOG
+
+/**
+* A thread function invocation
+*/
+struct dispatch_record
+{
+	uint16_t marker;
+	esr::thread_id id;
+	esr::message msg;
+};
+
+/**
+* dispatch_record::marker value of an invocation in progress
+*/
+const uint16_t DISPATCH_IN_PROGRESS = 0xD15A;
+
+/**
+* The current thread function invocation. 
+* The variable is not initialized on startup so it survives MCU reset
+*/
+#ifdef __AVR__
+dispatch_record _dispatch_record __attribute__((section(".noinit")));
+#else
+dispatch_record _dispatch_record;
+#endif
+
+/**
+* The invocation that has been interrupted by the last MCU reset
+*/
+dispatch_record _reset_culprit;
+
+#ifdef __AVR__
+
+/**
+* Reset cause flags (MCUSR value on startup), saved by esr_watchdog.cpp
+*/
+extern uint8_t _reset_flags;
+
+#endif
+
+#endif
+
+#ifdef __ESR_ENABLE_TRACE
+
+/**
+* A kernel trace event
+*/
+struct trace_event
+{
+	/**
+	* Event time, micros() / 16
+	*/
+	uint16_t time;
+	uint8_t type;
+	esr::thread_id thread;
+	esr::message msg;
+};
+
+/**
+* Ring buffer of trace events, the oldest events are overwritten
+*/
+trace_event _trace[__ESR_TRACE_BUFFER];
+uint8_t _trace_head;
+uint8_t _trace_count;
+
+/**
+* Time of the last recorded event (in terms of micros())
+*/
+uint32_t _trace_time;
+
+/**
+* Time of the oldest event in the buffer (in terms of micros())
+*/
+uint32_t _trace_start;
+
+/**
+* Puts an event into the trace buffer
+* @param time event time (in terms of micros())
+* @param type event type
+* @param thread thread identifier
+* @param msg message code
+*/
+void trace_put(uint32_t time, uint8_t type, esr::thread_id thread, esr::message msg)
+{
+	uint8_t tail = _trace_head + _trace_count;
+	if(tail >= __ESR_TRACE_BUFFER)
+	{
+		tail -= __ESR_TRACE_BUFFER;
+	}
+
+	if(_trace_count == 0)
+	{
+		_trace_start = time;
+	}
+
+	if(_trace_count < __ESR_TRACE_BUFFER)
+	{
+		++_trace_count;
+	}
+	else
+	{
+		// The oldest event is overwritten, keep track of the full time of the next one
+		uint16_t overwritten = _trace[_trace_head].time;
+		if(++_trace_head >= __ESR_TRACE_BUFFER)
+		{
+			_trace_head = 0;
+		}
+
+		const trace_event& oldest = _trace[_trace_head];
+		if(oldest.type == esr::TRACE_SYNC)
+		{
+			_trace_start = (static_cast<uint32_t>(oldest.msg) << 28) | 
+				(static_cast<uint32_t>(oldest.thread) << 20) | 
+				(static_cast<uint32_t>(oldest.time) << 4);
+		}
+		else
+		{
+			_trace_start += static_cast<uint32_t>(static_cast<uint16_t>(oldest.time - overwritten)) << 4;
+		}
+	}
+
+	trace_event& e = _trace[tail];
+	e.time = static_cast<uint16_t>(time >> 4);
+	e.type = type;
+	e.thread = thread;
+	e.msg = msg;
+}
+
+/**
+* Records a trace event. Must not be called from ISRs
+* @param type event type
+* @param thread thread identifier
+* @param msg message code
+*/
+void trace(esr::trace_event_type type, esr::thread_id thread, esr::message msg)
+{
+	uint32_t time = micros();
+
+	// 16-bit timestamp wraps around every 2^20 us, so longer gaps are marked with high bits of the time
+	if(_trace_count == 0 || time - _trace_time >= (1UL << 20))
+	{
+		trace_put(time, esr::TRACE_SYNC, static_cast<uint8_t>(time >> 20), static_cast<uint8_t>(time >> 28));
+	}
+
+	_trace_time = time;
+	trace_put(time, type, thread, msg);
+}
+
+#define ESR_TRACE(type, thread, msg) trace(type, thread, msg)
+
+#else
+
+#define ESR_TRACE(type, thread, msg)
+
+#endif
+
+/**
+* Timer slot
+*/
+struct timer_slot
+{
+	/**
+	* Time of the next invocation (in terms of millis())
+	*/
+	esr::timer_period deadline;
+
+	union
+	{
+		/**
+		* Timer period, 0 for one-shot timers
+		*/
+		esr::timer_period period;
+
+		/**
+		* Parameter of a delayed message (delayed messages are one-shot)
+		*/
+		esr::message_param param;
+	};
+
+	/**
+	* Owner thread
+	*/
+	esr::thread_id thread;
+
+	/**
+	* Message code to be delivered, MSG_NONE if the timer slot is free
+	*/
+	esr::message msg;
+
+	/**
+	* Catch-up policy of a periodic timer
+	*/
+	uint8_t policy : 2;
+
+	/**
+	* True if the timer is a delayed message delivery, such timers are freed after firing
+	*/
+	uint8_t delivery : 1;
+
+	/**
+	* (1-based) position of the timer in the timer heap, zero means that the timer is not armed
+	*/
+	uint8_t heap_position;
+};
+
+/**
+* Total amount of timers: first MAX_THREADS timers are thread's own timers (timer id is equal to thread id), 
+* the rest ones are allocated by esr::create_timer()
+*/
+const uint8_t TIMER_COUNT = esr::MAX_THREADS + esr::MAX_TIMERS;
+
+timer_slot _timers[TIMER_COUNT];
+
+/**
+* Armed timers as a binary min-heap of timer identifiers ordered by deadline.
+*/
+esr::timer_id _timer_heap[TIMER_COUNT];
+uint8_t _timer_heap_size;
+
+/**
+* Compares timer deadlines with respect to millis() overflow
+* @param a first deadline
+* @param b second deadline
+* @return true if deadline a comes before deadline b
+*/
+__inline__ bool deadline_before(esr::timer_period a, esr::timer_period b)
+{
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+/**
+* Puts a timer into the specified timer heap position
+* @param position 0-based heap position
+* @param id timer identifier
+*/
+__inline__ void timer_heap_place(uint8_t position, esr::timer_id id)
+{
+	_timer_heap[position] = id;
+	_timers[id].heap_position = position + 1;
+}
+
+/**
+* Restores heap order by moving a timer towards the heap root
+* @param position 0-based heap position
+*/
+void timer_heap_sift_up(uint8_t position)
+{
+	esr::timer_id id = _timer_heap[position];
+	esr::timer_period deadline = _timers[id].deadline;
+
+	while(position > 0)
+	{
+		uint8_t parent = (position - 1) / 2;
+		if(!deadline_before(deadline, _timers[_timer_heap[parent]].deadline))
+		{
+			break;
+		}
+
+		timer_heap_place(position, _timer_heap[parent]);
+		position = parent;
+	}
+
+	timer_heap_place(position, id);
+}
+
+/**
+* Restores heap order by moving a timer towards the heap leaves
+* @param position 0-based heap position
+*/
+void timer_heap_sift_down(uint8_t position)
+{
+	esr::timer_id id = _timer_heap[position];
+	esr::timer_period deadline = _timers[id].deadline;
+
+	while(true)
+	{
+		uint8_t child = position * 2 + 1;
+		if(child >= _timer_heap_size)
+		{
+			break;
+		}
+
+		// Pick the earliest of two children
+		if(child + 1 < _timer_heap_size &&
+			deadline_before(_timers[_timer_heap[child + 1]].deadline, _timers[_timer_heap[child]].deadline))
+		{
+			++child;
+		}
+
+		if(!deadline_before(_timers[_timer_heap[child]].deadline, deadline))
+		{
+			break;
+		}
+
+		timer_heap_place(position, _timer_heap[child]);
+		position = child;
+	}
+
+	timer_heap_place(position, id);
+}
+
+/**
+* Puts a timer into the heap or updates its position if timer's deadline has changed
+* @param id timer identifier
+*/
+void timer_heap_schedule(esr::timer_id id)
+{
+	timer_slot& timer = _timers[id];
+
+	if(timer.heap_position == 0)
+	{
+		// Append a new timer to the heap
+		timer_heap_place(_timer_heap_size, id);
+		++_timer_heap_size;
+		timer_heap_sift_up(_timer_heap_size - 1);
+		return;
+	}
+
+	// Deadline might move in both directions
+	uint8_t position = timer.heap_position - 1;
+	timer_heap_sift_up(position);
+	timer_heap_sift_down(timer.heap_position - 1);
+}
+
+/**
+* Removes a timer from the heap
+* @param id timer identifier
+*/
+void timer_heap_remove(esr::timer_id id)
+{
+	timer_slot& timer = _timers[id];
+	if(timer.heap_position == 0)
+	{
+		return;
+	}
+
+	uint8_t position = timer.heap_position - 1;
+	timer.heap_position = 0;
+
+	// Move the last heap element into the free position
+	--_timer_heap_size;
+	if(position == _timer_heap_size)
+	{
+		return;
+	}
+
+	timer_heap_place(position, _timer_heap[_timer_heap_size]);
+	timer_heap_schedule(_timer_heap[position]);
+}
+
+/**
+* Gets an identifier of the thread slot
+* @param slot thread slot
+* @return thread identifier
+*/
+__inline__ esr::thread_id get_thread_id(const thread_slot& slot)
+{
+	return static_cast<esr::thread_id>(&slot - _threads);
+}
+
+/**
+* Gets amount of mailbox pool entries not taken by thread message queues
+* @return amount of free entries
+*/
+uint8_t get_free_mailbox_entries()
+{
+	uint8_t used = 0;
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		used += _threads[i].queue_capacity;
+	}
+
+	return esr::MAILBOX_POOL - used;
+}
+
+/**
+* Moves pending messages of the thread to another place of the mailbox pool. 
+* The thread's ring buffer must be rewound
+* @param thread target thread
+* @param base new position of the thread's queue
+*/
+void move_mailbox(thread_slot& thread, uint8_t base)
+{
+	memmove(_mailbox_queue + base, _mailbox_queue + thread.queue_base, 
+		thread.queue_count * sizeof(esr::message));
+	memmove(_mailbox_params + base, _mailbox_params + thread.queue_base, 
+		thread.queue_count * sizeof(esr::message_param));
+	thread.queue_base = base;
+}
+
+/**
+* Changes message queue capacity of the thread and lays out message queues of all threads in the mailbox pool again
+* @param thread target thread
+* @param size new queue capacity, not less than amount of pending messages
+* @return true if the queue has been resized, false if the mailbox pool has not enough free entries
+*/
+bool resize_mailbox(thread_slot& thread, uint8_t size)
+{
+	if(size > get_free_mailbox_entries() + thread.queue_capacity)
+	{
+		return false;
+	}
+
+	// Pending messages are moved to the beginning of each queue 
+	// since ring buffer indices wrap around at the old capacity
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		_threads[i].rewind();
+	}
+
+	thread.queue_capacity = size;
+
+	// Queues keep their order in the pool: ones moving towards the beginning of the pool are moved first, 
+	// in ascending order, then the rest ones are moved in descending order, so no pending message is overwritten
+	uint8_t bases[esr::MAX_THREADS];
+	uint8_t base = 0;
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		bases[i] = base;
+		base += _threads[i].queue_capacity;
+	}
+
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		if(bases[i] < _threads[i].queue_base)
+		{
+			move_mailbox(_threads[i], bases[i]);
+		}
+	}
+
+	for(uint8_t i = esr::MAX_THREADS; i > 0; --i)
+	{
+		if(bases[i - 1] > _threads[i - 1].queue_base)
+		{
+			move_mailbox(_threads[i - 1], bases[i - 1]);
+		}
+	}
+
+	return true;
+}
+
+/**
+* Starts new thread
+* @param thread thread entry point
+* @param [out] an identifier of a new thread
+* @return error code
+*/
+esr::error esr::begin_thread(esr::thread_func thread, esr::thread_id& id)
+{
+	// Allocate an empty thread slot
+
+	// Search for the first empty thread slot
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		thread_slot& slot = _threads[i];
+		// If thread in the slot is not alive
+		if(!slot.has_flag(esr::THREAD_ALIVE))
+		{
+			// Message queue takes up to MAX_THREAD_QUEUE free mailbox pool entries
+			uint8_t queue_size = get_free_mailbox_entries();
+			if(queue_size == 0)
+			{
+				break;
+			}
+
+			if(queue_size > esr::MAX_THREAD_QUEUE)
+			{
+				queue_size = esr::MAX_THREAD_QUEUE;
+			}
+
+			// Take the slot
+			id = i;
+
+			slot.func = thread;
+
+			// Reset thread flags: 
+			//  * thread is alive, 
+			//  * idle loop enabled, 
+			//  * repeat timer enabled, 
+			//  * timer disabled
+			slot.set_flag(esr::THREAD_ALIVE);
+			slot.set_flag(esr::THREAD_IDLE_LOOP);
+			slot.set_flag(esr::THREAD_REPEAT_TIMER);
+			slot.clear_flag(esr::THREAD_ENABLE_TIMER);
+			_idle_threads |= thread_bit(i);
+
+			slot.priority = esr::PRIORITY_NORMAL;
+			_priority_threads[esr::PRIORITY_NORMAL] |= thread_bit(i);
+			slot.drain_limit = 1;
+
+			// Thread's own timer
+			timer_slot& timer = _timers[i];
+			timer.thread = i;
+			timer.msg = esr::MSG_TIMER;
+			timer.policy = esr::CATCH_UP_SKIP;
+			timer.period = 0;
+			timer.deadline = 0;
+
+#ifdef __ESR_ENABLE_TIME_BUDGETS
+			slot.time_budget = __ESR_DEFAULT_TIME_BUDGET;
+#endif
+
+			// Clear message queue
+			slot.queue_head = 0;
+			slot.queue_count = 0;
+			resize_mailbox(slot, queue_size);
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+			slot.stats = esr::thread_stats();
+#endif
+
+#ifdef __ESR_ENABLE_KERNEL_LOGGING
+			//esr::log_d(F("begin_thread: E_OK"));
+#endif
+			return esr::E_OK;
+		}
+	}
+
+	// All thread slots (or mailbox pool entries) are taken, unable to create a new thread
+#ifdef __ESR_ENABLE_KERNEL_LOGGING
+	// esr::log_d(F("begin_thread: E_NO_FREE_THREAD_SLOTS"));
+#endif
+	return esr::E_NO_FREE_THREAD_SLOTS;
+}
+
+/**
+* Gets a thread slot
+* @param id thread identifier
+* @param value [out] an output value
+* @return error code
+*/
+esr::error get_thread_slot(esr::thread_id id, thread_slot*& value)
+{
+	// If id == esr::THREAD_CURRENT then take current thread's identifier
+	if(id == esr::THREAD_CURRENT)
+	{
+		// Check if function is called from a code within scheduler loop
+		// This is required only if id == esr::THREAD_CURRENT
+		if(!_is_in_thread)
+		{
+			return esr::E_NOT_IN_SCHEDULER;
+		}
+
+		id = _current_thread_id;
+	}
+
+	// Check if thread identifier is within an allowed range
+	if(id >= esr::MAX_THREADS)
+	{
+		return esr::E_WRONG_THREAD;
+	}
+
+	// Check if the specified thread is alive
+	thread_slot& slot = _threads[id];
+	if(!slot.has_flag(esr::THREAD_ALIVE))
+	{
+		return esr::E_WRONG_THREAD;
+	}
+
+	value = &slot;
+	return esr::E_OK;
+}
+
+/**
+* Gets a thread flag
+* @param id thread identifier
+* @param flag target thread flag
+* @param value [out] a value indicating if flag is set or not
+* @return error code
+*/
+esr::error esr::get_thread_flag(esr::thread_id id, esr::thread_flags flag, bool& value)
+{
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	// Return thread flag
+	value = slot_ptr->has_flag(flag);
+	return esr::E_OK;
+}
+
+/**
+* Sets a thread flag
+* @param id thread identifier
+* @param flag target thread flag
+* @param value true to set the flag, false to clear it
+* @return error code
+*/
+esr::error esr::set_thread_flag(esr::thread_id id, esr::thread_flags flag, bool value)
+{
+	// Check if flag is not readonly
+	if(flag == esr::THREAD_ALIVE)
+	{
+		return esr::E_WRONG_FLAG;
+	}
+
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	// Set or clear the thread flag according to value parameter
+	if(value)
+	{
+		slot_ptr->set_flag(flag);
+	}
+	else
+	{
+		slot_ptr->clear_flag(flag);
+	}
+
+	// Keep idle loop mask consistent with THREAD_IDLE_LOOP flag
+	if(flag == esr::THREAD_IDLE_LOOP)
+	{
+		esr::thread_mask bit = thread_bit(get_thread_id(*slot_ptr));
+		if(value)
+		{
+			_idle_threads |= bit;
+		}
+		else
+		{
+			_idle_threads &= ~bit;
+		}
+	}
+
+	// Keep timer heap consistent with THREAD_ENABLE_TIMER flag
+	if(flag == esr::THREAD_ENABLE_TIMER)
+	{
+		// Thread's own timer keeps its next deadline while disarmed
+		esr::timer_id timer = get_thread_id(*slot_ptr);
+		if(value)
+		{
+			timer_heap_schedule(timer);
+		}
+		else
+		{
+			timer_heap_remove(timer);
+		}
+	}
+
+	return esr::E_OK;
+}
+
+/**
+* Sets thread priority
+* @param id thread identifier
+* @param priority thread priority, from PRIORITY_LOW to PRIORITY_HIGH
+* @return error code
+*/
+esr::error esr::set_thread_priority(esr::thread_id id, esr::thread_priority priority)
+{
+	// Validate thread priority
+	if(priority > esr::PRIORITY_HIGH)
+	{
+		return esr::E_WRONG_PRIORITY;
+	}
+
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	esr::thread_mask bit = thread_bit(get_thread_id(*slot_ptr));
+	_priority_threads[slot_ptr->priority] &= ~bit;
+	_priority_threads[priority] |= bit;
+
+	slot_ptr->priority = priority;
+	return esr::E_OK;
+}
+
+/**
+* Sets amount of messages the thread receives within one scheduler loop iteration
+* @param id thread identifier
+* @param limit maximum amount of messages per iteration, DRAIN_ALL to drain the queue
+* @return error code
+*/
+esr::error esr::set_thread_drain(esr::thread_id id, uint8_t limit)
+{
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	slot_ptr->drain_limit = limit;
+	return esr::E_OK;
+}
+
+#ifdef __ESR_ENABLE_TIME_BUDGETS
+
+/**
+* Sets thread time budget
+* @param id thread identifier
+* @param budget time budget in milliseconds, 0 disables the check
+* @return error code
+*/
+esr::error esr::set_thread_time_budget(esr::thread_id id, uint16_t budget)
+{
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	slot_ptr->time_budget = budget;
+	return esr::E_OK;
+}
+
+#endif
+
+/**
+* Terminates thread
+* @param id thread identifier
+* @return error code
+*/
+esr::error esr::kill_thread(esr::thread_id id)
+{
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	// Let the thread to finalize by invoking it with MSG_FINALIZE message
+	slot_ptr->func(esr::MSG_FINALIZE, 0);
+
+	// Mark the thread as a dead one	
+	slot_ptr->clear_flag(esr::THREAD_ALIVE);
+
+	// Disarm thread's timer and delete timers owned by the thread
+	slot_ptr->clear_flag(esr::THREAD_ENABLE_TIMER);
+	esr::thread_id thread = get_thread_id(*slot_ptr);
+	timer_heap_remove(thread);
+	for(esr::timer_id i = esr::MAX_THREADS; i < TIMER_COUNT; ++i)
+	{
+		if(_timers[i].msg != esr::MSG_NONE && _timers[i].thread == thread)
+		{
+			timer_heap_remove(i);
+			_timers[i].msg = esr::MSG_NONE;
+		}
+	}
+
+	// Unsubscribe from all topics
+	esr::thread_mask mask = ~thread_bit(get_thread_id(*slot_ptr));
+	for(uint8_t i = 0; i < esr::MAX_TOPICS; ++i)
+	{
+		_topics[i] &= mask;
+	}
+
+	// Pending messages are dropped, mailbox pool entries are reclaimed by the next queue layout
+	slot_ptr->queue_count = 0;
+	slot_ptr->queue_capacity = 0;
+	_pending_threads &= mask;
+	_idle_threads &= mask;
+	_priority_threads[slot_ptr->priority] &= mask;
+
+#ifdef __ESR_ENABLE_KERNEL_LOGGING
+	// esr::log_d(F("kill_thread 0x%xd E_OK"), id);
+#endif
+	return esr::E_OK;
+}
+
+/**
+* Puts a message into thread's message queue
+* @param id thread identifier
+* @param msg message code
+* @param param message parameter
+* @return error code
+*/
+esr::error esr::post_message(esr::thread_id id, esr::message msg, esr::message_param param)
+{
+	// Check if message can be posted by client code
+	if(msg ==  esr::MSG_NONE || 
+		msg ==  esr::MSG_IDLE || 
+		msg ==  esr::MSG_TIMER)
+	{
+		// MSG_NONE, MSG_IDLE, MSG_TIMER are system defined messages, 
+		// they cannot be posted into message queue
+		return esr::E_WRONG_MESSAGE;
+	}
+
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	// Coalesced message that is already pending just receives the new parameter
+	uint8_t index;
+	if(is_coalesced(msg) && slot_ptr->find(msg, index))
+	{
+		_mailbox_params[index] = param;
+		return esr::E_OK;
+	}
+
+	// Check if there is a free place in the message queue
+	if(slot_ptr->queue_is_full())
+	{
+#ifdef __ESR_ENABLE_THREAD_STATS
+		++slot_ptr->stats.dropped_messages;
+#endif
+		ESR_TRACE(esr::TRACE_QUEUE_FULL, get_thread_id(*slot_ptr), msg);
+		return esr::E_MESSAGE_QUEUE_IS_FULL;
+	}
+
+	// Put message at the tail of the queue
+	slot_ptr->enqueue(msg, param);
+	_pending_threads |= thread_bit(get_thread_id(*slot_ptr));
+	ESR_TRACE(esr::TRACE_POST, get_thread_id(*slot_ptr), msg);
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+	if(slot_ptr->queue_count > slot_ptr->stats.queue_high_water)
+	{
+		slot_ptr->stats.queue_high_water = slot_ptr->queue_count;
+	}
+#endif
+
+	return esr::E_OK;
+}
+
+/**
+* Enables or disables coalescing of the message code
+* @param msg message code
+* @param value true to enable coalescing, false to disable it
+* @return error code
+*/
+esr::error esr::set_message_coalescing(esr::message msg, bool value)
+{
+	// System messages are never posted into message queues
+	if(msg < esr::MSG_USER || msg >= esr::MAX_COALESCED_MESSAGES)
+	{
+		return esr::E_WRONG_MESSAGE;
+	}
+
+	uint8_t mask = 1 << (msg & 0x07);
+	if(value)
+	{
+		_coalesced_messages[msg >> 3] |= mask;
+	}
+	else
+	{
+		_coalesced_messages[msg >> 3] &= ~mask;
+	}
+
+	return esr::E_OK;
+}
+
+/**
+* Subscribes thread to a topic
+* @param id thread identifier
+* @param topic topic identifier
+* @return error code
+*/
+esr::error esr::subscribe(esr::thread_id id, esr::topic_id topic)
+{
+	// Validate topic identifier
+	if(topic >= esr::MAX_TOPICS)
+	{
+		return esr::E_WRONG_TOPIC;
+	}
+
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	_topics[topic] |= thread_bit(get_thread_id(*slot_ptr));
+	return esr::E_OK;
+}
+
+/**
+* Unsubscribes thread from a topic
+* @param id thread identifier
+* @param topic topic identifier
+* @return error code
+*/
+esr::error esr::unsubscribe(esr::thread_id id, esr::topic_id topic)
+{
+	// Validate topic identifier
+	if(topic >= esr::MAX_TOPICS)
+	{
+		return esr::E_WRONG_TOPIC;
 	}
 
-	__inline__ void clear_flag(esr::thread_flags flag)
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
 	{
-		flags = static_cast<esr::thread_flags>(flags & ~flag);
+		return e;
 	}
-};
 
-thread_slot _threads[esr::MAX_THREADS];
-bool _is_in_thread;
-esr::thread_id _current_thread_id;
+	_topics[topic] &= ~thread_bit(get_thread_id(*slot_ptr));
+	return esr::E_OK;
+}
 
 /**
-* Starts new thread
-* @param thread thread entry point
-* @param [out] an identifier of a new thread
-* @return error code
+* Posts a message to every thread subscribed to the topic
+* @param topic topic identifier
+* @param msg message code
+* @param param message parameter
+* @return error code, E_MESSAGE_QUEUE_IS_FULL if the message has not been delivered to some subscribers
 */
-esr::error esr::begin_thread(esr::thread_func thread, esr::thread_id& id)
+esr::error esr::publish(esr::topic_id topic, esr::message msg, esr::message_param param)
 {
-	// Allocate an empty thread slot
+	// Validate topic identifier
+	if(topic >= esr::MAX_TOPICS)
+	{
+		return esr::E_WRONG_TOPIC;
+	}
 
-	// Search for the first empty thread slot
-	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	esr::error result = esr::E_OK;
+
+	// Walk through set bits only
+	esr::thread_mask subscribers = _topics[topic];
+	while(subscribers != 0)
 	{
-		thread_slot& slot = _threads[i];
-		// If thread in the slot is not alive
-		if(!slot.has_flag(esr::THREAD_ALIVE))
+		esr::thread_id id = first_thread(subscribers);
+		subscribers &= subscribers - 1;
+
+		esr::error e = esr::post_message(id, msg, param);
+		if(e != esr::E_OK)
 		{
-			// Take the slot
-			id = i;
+			result = e;
+		}
+	}
 
-			slot.func = thread;
+	return result;
+}
 
-			// Reset thread flags: 
-			//  * thread is alive, 
-			//  * idle loop enabled, 
-			//  * repeat timer enabled, 
-			//  * timer disabled
-			slot.set_flag(esr::THREAD_ALIVE);
-			slot.set_flag(esr::THREAD_IDLE_LOOP);
-			slot.set_flag(esr::THREAD_REPEAT_TIMER);
-			slot.clear_flag(esr::THREAD_ENABLE_TIMER);
+/**
+* Puts a message into thread's message queue from an interrupt service routine
+* @param id thread identifier
+* @param msg message code
+* @param param message parameter
+* @return error code
+*/
+esr::error esr::post_message_from_isr(esr::thread_id id, esr::message msg, esr::message_param param)
+{
+	// MSG_NONE, MSG_IDLE, MSG_TIMER are system defined messages
+	if(msg ==  esr::MSG_NONE || 
+		msg ==  esr::MSG_IDLE || 
+		msg ==  esr::MSG_TIMER)
+	{
+		return esr::E_WRONG_MESSAGE;
+	}
 
-			// Clear message queue
-			for(uint8_t j = 0; j < esr::MAX_THREAD_QUEUE; ++j)
-			{
-				slot.queue[j] = esr::MSG_NONE;
-			}
+	// There is no current thread in ISR context
+	if(id >= esr::MAX_THREADS)
+	{
+		return esr::E_WRONG_THREAD;
+	}
 
-#ifdef __ESR_ENABLE_KERNEL_LOGGING
-			//esr::log_d(F("begin_thread: E_OK"));
+	uint8_t tail = _isr_tail;
+	uint8_t next = (tail + 1) & (__ESR_ISR_QUEUE - 1);
+	if(next == _isr_head)
+	{
+#ifdef __ESR_ENABLE_THREAD_STATS
+		++_dropped_isr_messages;
 #endif
-			return esr::E_OK;
-		}
+		return esr::E_MESSAGE_QUEUE_IS_FULL;
 	}
 
-	// All thread slots are taken, unable to create a new thread
-#ifdef __ESR_ENABLE_KERNEL_LOGGING
-	// esr::log_d(F("begin_thread: E_NO_FREE_THREAD_SLOTS"));
-#endif
-	return esr::E_NO_FREE_THREAD_SLOTS;
+	isr_message& entry = _isr_queue[tail];
+	entry.id = id;
+	entry.msg = msg;
+	entry.param = param;
+
+	// Publish the entry only after it is completely written
+	ESR_MEMORY_BARRIER();
+	_isr_tail = next;
+
+	return esr::E_OK;
 }
 
 /**
-* Gets a thread slot
-* @param id thread identifier
-* @param value [out] an output value
+* Puts a work item into the deferred work queue
+* @param func work function
+* @param param work function parameter
 * @return error code
 */
-esr::error get_thread_slot(esr::thread_id id, thread_slot*& value)
+esr::error esr::defer(esr::work_func func, esr::message_param param)
 {
-	// If id == esr::THREAD_CURRENT then take current thread's identifier
-	if(id == esr::THREAD_CURRENT)
+	// Skip the item if the same one is still pending
+	uint8_t i = _work_head;
+	for(uint8_t n = 0; n < _work_count; ++n)
 	{
-		// Check if function is called from a code within scheduler loop
-		// This is required only if id == esr::THREAD_CURRENT
-		if(!_is_in_thread)
+		if(_work_queue[i].func == func && _work_queue[i].param == param)
 		{
-			return esr::E_NOT_IN_SCHEDULER;
+			return esr::E_OK;
 		}
 
-		id = _current_thread_id;
+		++i;
+		if(i >= esr::MAX_DEFERRED_WORK)
+		{
+			i = 0;
+		}
 	}
 
-	// Check if thread identifier is within an allowed range
-	if(id >= esr::MAX_THREADS)
+	if(_work_count >= esr::MAX_DEFERRED_WORK)
 	{
-		return esr::E_WRONG_THREAD;
+		return esr::E_WORK_QUEUE_IS_FULL;
 	}
 
-	// Check if the specified thread is alive
-	thread_slot& slot = _threads[id];
-	if(!slot.has_flag(esr::THREAD_ALIVE))
+	uint8_t tail = _work_head + _work_count;
+	if(tail >= esr::MAX_DEFERRED_WORK)
 	{
-		return esr::E_WRONG_THREAD;
+		tail -= esr::MAX_DEFERRED_WORK;
 	}
 
-	value = &slot;
+	_work_queue[tail].func = func;
+	_work_queue[tail].param = param;
+	++_work_count;
+
 	return esr::E_OK;
 }
 
 /**
-* Gets a thread flag
+* Takes a work item from the head of the deferred work queue and runs it. The queue must not be empty.
+*/
+void run_deferred_work()
+{
+	// The item is removed before invocation so the work function is able to defer more work
+	work_item item = _work_queue[_work_head];
+
+	++_work_head;
+	if(_work_head >= esr::MAX_DEFERRED_WORK)
+	{
+		_work_head = 0;
+	}
+
+	--_work_count;
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+	uint32_t start = micros();
+	item.func(item.param);
+	_busy_time += micros() - start;
+#else
+	item.func(item.param);
+#endif
+}
+
+/**
+* Moves messages posted from ISRs into thread message queues
+*/
+void receive_isr_messages()
+{
+	uint8_t head = _isr_head;
+	while(head != _isr_tail)
+	{
+		ESR_MEMORY_BARRIER();
+
+		const isr_message& entry = _isr_queue[head];
+
+		// Target thread might have been terminated or its queue might be full, 
+		// such messages are dropped
+		esr::post_message(entry.id, entry.msg, entry.param);
+
+		head = (head + 1) & (__ESR_ISR_QUEUE - 1);
+
+		// Release the entry only after it has been read
+		ESR_MEMORY_BARRIER();
+		_isr_head = head;
+	}
+}
+
+/**
+* Changes message queue capacity of the thread
 * @param id thread identifier
-* @param flag target thread flag
-* @param value [out] a value indicating if flag is set or not
+* @param size new queue capacity, from 1 to MAX_THREAD_QUEUE
 * @return error code
 */
-esr::error esr::get_thread_flag(esr::thread_id id, esr::thread_flags flag, bool& value)
+esr::error esr::set_thread_queue_size(esr::thread_id id, uint8_t size)
 {
+	// Validate queue size
+	if(size == 0 || size > esr::MAX_THREAD_QUEUE)
+	{
+		return esr::E_WRONG_QUEUE_SIZE;
+	}
+
 	// Retreive thread slot if possible
 	thread_slot* slot_ptr = NULL;
 	esr::error e = get_thread_slot(id, slot_ptr);
@@ -137,27 +1396,222 @@ esr::error esr::get_thread_flag(esr::thread_id id, esr::thread_flags flag, bool&
 		return e;
 	}
 
-	// Return thread flag
-	value = slot_ptr->has_flag(flag);
+	// Pending messages must fit into the new queue
+	if(slot_ptr->queue_count > size)
+	{
+		return esr::E_WRONG_QUEUE_SIZE;
+	}
+
+	// Other threads' queues might take the room
+	if(!resize_mailbox(*slot_ptr, size))
+	{
+		return esr::E_WRONG_QUEUE_SIZE;
+	}
+
 	return esr::E_OK;
 }
 
 /**
-* Sets a thread flag
+* Invokes thread function, accounts time spent in it and checks thread's time budget
+* @param thread target thread
+* @param msg message code
+* @param param message parameter
+*/
+void dispatch(thread_slot& thread, esr::message msg, esr::message_param param)
+{
+#ifdef __ESR_ENABLE_WATCHDOG
+	// Record the invocation so it can be identified after a watchdog reset. 
+	// Thread functions might be invoked recursively (ex. by esr::set_timer_ms())
+	dispatch_record outer = _dispatch_record;
+	_dispatch_record.id = get_thread_id(thread);
+	_dispatch_record.msg = msg;
+	_dispatch_record.marker = DISPATCH_IN_PROGRESS;
+#ifdef __AVR__
+	wdt_reset();
+#endif
+#endif
+
+	ESR_TRACE(esr::TRACE_DISPATCH_BEGIN, get_thread_id(thread), msg);
+
+#if defined(__ESR_ENABLE_THREAD_STATS) || defined(__ESR_ENABLE_TIME_BUDGETS)
+	uint32_t start = micros();
+	thread.func(msg, param);
+	uint32_t elapsed = micros() - start;
+#else
+	thread.func(msg, param);
+#endif
+
+	ESR_TRACE(esr::TRACE_DISPATCH_END, get_thread_id(thread), msg);
+
+#ifdef __ESR_ENABLE_WATCHDOG
+	_dispatch_record = outer;
+#endif
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+	esr::thread_stats& stats = thread.stats;
+	++stats.dispatch_count;
+	stats.total_time += elapsed;
+	if(elapsed > stats.max_time)
+	{
+		stats.max_time = elapsed;
+	}
+
+	_busy_time += elapsed;
+#endif
+
+#ifdef __ESR_ENABLE_TIME_BUDGETS
+	if(thread.time_budget != 0 && elapsed > thread.time_budget * 1000UL)
+	{
+#ifdef __ESR_ENABLE_THREAD_STATS
+		++stats.budget_overruns;
+#endif
+		esr::log(esr::LOG_ERROR, F("ESR\tthread %ub overrun: msg=%ub time=%ul"), get_thread_id(thread), msg, &elapsed);
+	}
+#endif
+}
+
+/**
+* Fires timer, reschedules or disarms it
+* @param id timer identifier
+* @param time current time
+*/
+void fire_timer(esr::timer_id id, esr::timer_period time)
+{
+	timer_slot& timer = _timers[id];
+
+	// Delayed message goes into thread's message queue, the timer is released
+	if(timer.delivery)
+	{
+		esr::message msg = timer.msg;
+		timer_heap_remove(id);
+		timer.msg = esr::MSG_NONE;
+
+		// Thread's message queue might be full, the message is dropped then
+		esr::post_message(timer.thread, msg, timer.param);
+		return;
+	}
+
+	thread_slot& thread = _threads[timer.thread];
+	ESR_TRACE(esr::TRACE_TIMER, timer.thread, timer.msg);
+
+	// Thread's own timer repeats according to THREAD_REPEAT_TIMER flag
+	bool repeat = timer.period != 0 && 
+		(id >= esr::MAX_THREADS || thread.has_flag(esr::THREAD_REPEAT_TIMER));
+
+	// The next deadline is counted from the previous one, not from the actual invocation
+	bool late = timer.deadline != time;
+	timer.deadline += timer.period;
+
+	// Reschedule or disarm the timer before invoking the thread 
+	// so the thread is able to change or restart its timer
+	if(repeat)
+	{
+		switch(timer.policy)
+		{
+		case esr::CATCH_UP_SKIP:
+			// Skip deadlines that have been missed already
+			if(!deadline_before(time, timer.deadline))
+			{
+				timer.deadline += ((time - timer.deadline) / timer.period + 1) * timer.period;
+			}
+			break;
+
+		case esr::CATCH_UP_RESTART:
+			if(late)
+			{
+				timer.deadline = time + timer.period;
+			}
+			break;
+		}
+
+		timer_heap_schedule(id);
+	}
+	else
+	{
+		timer_heap_remove(id);
+
+		// THREAD_REPEAT_TIMER flag is not set so clear the THREAD_ENABLE_TIMER flag
+		if(id < esr::MAX_THREADS)
+		{
+			thread.clear_flag(esr::THREAD_ENABLE_TIMER);
+		}
+	}
+
+	// Invoke thread with timer's message
+	dispatch(thread, timer.msg, 0);
+}
+
+/**
+* Gets a timer slot created by esr::create_timer()
+* @param id timer identifier
+* @param value [out] timer slot
+* @return error code
+*/
+esr::error get_timer_slot(esr::timer_id id, timer_slot*& value)
+{
+	// Thread's own timers are not accessible by identifier
+	if(id < esr::MAX_THREADS || id >= TIMER_COUNT)
+	{
+		return esr::E_WRONG_TIMER;
+	}
+
+	// Delayed messages are not accessible either
+	timer_slot& timer = _timers[id];
+	if(timer.msg == esr::MSG_NONE || timer.delivery)
+	{
+		return esr::E_WRONG_TIMER;
+	}
+
+	value = &timer;
+	return esr::E_OK;
+}
+
+/**
+* Takes the first free timer slot
+* @param thread owner thread
+* @param msg message code to be delivered by the timer
+* @param id [out] timer identifier
+* @return true if a timer has been allocated, false if all timers are taken
+*/
+bool allocate_timer(esr::thread_id thread, esr::message msg, esr::timer_id& id)
+{
+	for(esr::timer_id i = esr::MAX_THREADS; i < TIMER_COUNT; ++i)
+	{
+		timer_slot& timer = _timers[i];
+		if(timer.msg == esr::MSG_NONE)
+		{
+			timer.thread = thread;
+			timer.msg = msg;
+			timer.period = 0;
+			timer.policy = esr::CATCH_UP_SKIP;
+			timer.heap_position = 0;
+
+			id = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+* Creates a timer
 * @param id thread identifier
-* @param flag target thread flag
-* @param value true to set the flag, false to clear it
+* @param msg message code to be delivered by the timer
+* @param timer [out] timer identifier
 * @return error code
 */
-esr::error esr::set_thread_flag(esr::thread_id id, esr::thread_flags flag, bool value)
+esr::error esr::create_timer(esr::thread_id id, esr::message msg, esr::timer_id& timer)
 {
-	// Check if flag is not readonly
-	if(flag == esr::THREAD_ALIVE)
+	// MSG_NONE, MSG_IDLE, MSG_FINALIZE are reserved for the scheduler
+	if(msg == esr::MSG_NONE || 
+		msg == esr::MSG_IDLE ||
+		msg == esr::MSG_FINALIZE)
 	{
-		return esr::E_WRONG_FLAG;
+		return esr::E_WRONG_MESSAGE;
 	}
 
-	// Retreive thread slot if possible
+	// Retrieve thread slot if possible
 	thread_slot* slot_ptr = NULL;
 	esr::error e = get_thread_slot(id, slot_ptr);
 	if(e != esr::E_OK)
@@ -165,64 +1619,111 @@ esr::error esr::set_thread_flag(esr::thread_id id, esr::thread_flags flag, bool
 		return e;
 	}
 
-	// Set or clear the thread flag according to value parameter
-	if(value)
+	if(!allocate_timer(get_thread_id(*slot_ptr), msg, timer))
 	{
-		slot_ptr->set_flag(flag);
+		return esr::E_NO_FREE_TIMERS;
 	}
-	else
+
+	_timers[timer].delivery = false;
+	return esr::E_OK;
+}
+
+/**
+* Starts (or restarts) a timer
+* @param timer timer identifier
+* @param delay time until the first invocation in milliseconds
+* @param period timer period in milliseconds, 0 for one-shot timer
+* @param policy behavior of a periodic timer that has missed its deadlines
+* @return error code
+*/
+esr::error esr::start_timer(esr::timer_id timer, esr::timer_period delay, esr::timer_period period, esr::catch_up_policy policy)
+{
+	// Retrieve timer slot if possible
+	timer_slot* timer_ptr = NULL;
+	esr::error e = get_timer_slot(timer, timer_ptr);
+	if(e != esr::E_OK)
 	{
-		slot_ptr->clear_flag(flag);
+		return e;
 	}
+
+	timer_ptr->period = period;
+	timer_ptr->policy = policy;
+	timer_ptr->deadline = millis() + delay;
+	timer_heap_schedule(timer);
 	return esr::E_OK;
 }
 
 /**
-* Terminates thread
-* @param id thread identifier
+* Stops a timer
+* @param timer timer identifier
 * @return error code
 */
-esr::error esr::kill_thread(esr::thread_id id)
+esr::error esr::stop_timer(esr::timer_id timer)
+{
+	// Retrieve timer slot if possible
+	timer_slot* timer_ptr = NULL;
+	esr::error e = get_timer_slot(timer, timer_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	timer_heap_remove(timer);
+	return esr::E_OK;
+}
+
+/**
+* Stops and deletes a timer
+* @param timer timer identifier
+* @return error code
+*/
+esr::error esr::delete_timer(esr::timer_id timer)
 {
-	// Retreive thread slot if possible
-	thread_slot* slot_ptr = NULL;
-	esr::error e = get_thread_slot(id, slot_ptr);
+	// Retrieve timer slot if possible
+	timer_slot* timer_ptr = NULL;
+	esr::error e = get_timer_slot(timer, timer_ptr);
 	if(e != esr::E_OK)
 	{
 		return e;
 	}
 
-	// Let the thread to finalize by invoking it with MSG_FINALIZE message
-	slot_ptr->func(esr::MSG_FINALIZE);
-
-	// Mark the thread as a dead one	
-	slot_ptr->clear_flag(esr::THREAD_ALIVE);
-
-#ifdef __ESR_ENABLE_KERNEL_LOGGING
-	// esr::log_d(F("kill_thread 0x%xd E_OK"), id);
-#endif
+	timer_heap_remove(timer);
+	timer_ptr->msg = esr::MSG_NONE;
 	return esr::E_OK;
 }
 
 /**
-* Puts a message into thread's message queue
+* Puts a message into thread's message queue after the specified delay
 * @param id thread identifier
 * @param msg message code
+* @param delay delay in milliseconds
+* @param param message parameter
 * @return error code
 */
-esr::error esr::post_message(esr::thread_id id, esr::message msg)
+esr::error esr::post_message_after(esr::thread_id id, esr::message msg, esr::timer_period delay, esr::message_param param)
 {
-	// Check if message can be posted by client code
+	return esr::post_message_at(id, msg, millis() + delay, param);
+}
+
+/**
+* Puts a message into thread's message queue at the specified time
+* @param id thread identifier
+* @param msg message code
+* @param time delivery time (in terms of millis())
+* @param param message parameter
+* @return error code
+*/
+esr::error esr::post_message_at(esr::thread_id id, esr::message msg, esr::timer_period time, esr::message_param param)
+{
+	// MSG_NONE, MSG_IDLE, MSG_TIMER are system defined messages
 	if(msg ==  esr::MSG_NONE || 
 		msg ==  esr::MSG_IDLE || 
 		msg ==  esr::MSG_TIMER)
 	{
-		// MSG_NONE, MSG_IDLE, MSG_TIMER are system defined messages, 
-		// they cannot be posted into message queue
 		return esr::E_WRONG_MESSAGE;
 	}
 
-	// Retreive thread slot if possible
+	// Retrieve thread slot if possible
 	thread_slot* slot_ptr = NULL;
 	esr::error e = get_thread_slot(id, slot_ptr);
 	if(e != esr::E_OK)
@@ -230,41 +1731,48 @@ esr::error esr::post_message(esr::thread_id id, esr::message msg)
 		return e;
 	}
 
-	// If queue element at queue_tail is taken then move tail
-	if(slot_ptr->queue[slot_ptr->queue_tail] != esr::MSG_NONE)
+	esr::timer_id timer;
+	if(!allocate_timer(get_thread_id(*slot_ptr), msg, timer))
 	{
-		// If tail is at the last possible position then message queue is full
-		if(slot_ptr->queue_tail >= esr::MAX_THREAD_QUEUE)
-		{
-			return esr::E_MESSAGE_QUEUE_IS_FULL;
-		}
-
-		++slot_ptr->queue_tail;
+		return esr::E_NO_FREE_TIMERS;
 	}
 
-	// Put message into the slot
-	slot_ptr->queue[slot_ptr->queue_tail] = msg;
+	timer_slot& slot = _timers[timer];
+	slot.delivery = true;
+	slot.param = param;
+	slot.deadline = time;
+	timer_heap_schedule(timer);
 	return esr::E_OK;
 }
 
 /**
-* Fires timer for the thread slot and updates thread flags
-* @param slot thread slot
-* @param time current time
+* Cancels pending deliveries of the message
+* @param id thread identifier
+* @param msg message code
+* @return error code
 */
-void fire_timer(thread_slot& slot, esr::timer_period time)
+esr::error esr::cancel_message(esr::thread_id id, esr::message msg)
 {
-	// Invoke thread with MSG_TIMER message
-	slot.func(esr::MSG_TIMER);
-
-	// Update last_invokation time
-	slot.last_invokation = time;
+	// Retrieve thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
 
-	// If THREAD_REPEAT_TIMER flag is not set then clear the THREAD_ENABLE_TIMER flag
-	if(!slot.has_flag(esr::THREAD_REPEAT_TIMER))
+	esr::thread_id thread = get_thread_id(*slot_ptr);
+	for(esr::timer_id i = esr::MAX_THREADS; i < TIMER_COUNT; ++i)
 	{
-		slot.clear_flag(esr::THREAD_ENABLE_TIMER);
+		timer_slot& timer = _timers[i];
+		if(timer.delivery && timer.msg == msg && timer.thread == thread)
+		{
+			timer_heap_remove(i);
+			timer.msg = esr::MSG_NONE;
+		}
 	}
+
+	return esr::E_OK;
 }
 
 /**
@@ -291,17 +1799,24 @@ esr::error esr::set_timer_ms(esr::thread_id id, esr::timer_period period)
 
 	// Enable timer for the thread
 	slot_ptr->set_flag(esr::THREAD_ENABLE_TIMER);
-	slot_ptr->period = period;
-	// The timer will fire at current_time + period
+
+	esr::timer_id thread = get_thread_id(*slot_ptr);
+	timer_slot& timer = _timers[thread];
+	timer.period = period;
 	esr::timer_period time = millis();
-	slot_ptr->last_invokation = time;
 
 	// If THREAD_IMMEDIATE_TIMER flag is set the fire timer immediately
 	if(slot_ptr->has_flag(esr::THREAD_IMMEDIATE_TIMER))
 	{
-		fire_timer(*slot_ptr, time);
+		timer.deadline = time;
+		timer_heap_schedule(thread);
+		fire_timer(thread, time);
+		return esr::E_OK;
 	}
 
+	// The timer will fire at current_time + period
+	timer.deadline = time + period;
+	timer_heap_schedule(thread);
 	return esr::E_OK;
 }
 
@@ -334,8 +1849,12 @@ esr::error esr::change_timer_ms(esr::thread_id id, esr::timer_period period)
 		return esr::E_TIMER_NOT_DEFINED;
 	}
 
-	// Change timer period
-	slot_ptr->period = period;
+	// Change timer period, the next invocation is counted from the previous one
+	esr::timer_id thread = get_thread_id(*slot_ptr);
+	timer_slot& timer = _timers[thread];
+	timer.deadline = timer.deadline - timer.period + period;
+	timer.period = period;
+	timer_heap_schedule(thread);
 	return esr::E_OK;
 }
 
@@ -362,6 +1881,23 @@ esr::error esr::clear_timer(esr::thread_id id)
 
 	// Clear the THREAD_ENABLE_TIMER flag
 	slot_ptr->clear_flag(esr::THREAD_ENABLE_TIMER);
+	timer_heap_remove(get_thread_id(*slot_ptr));
+	return esr::E_OK;
+}
+
+/**
+* Gets the earliest deadline among all armed timers
+* @param deadline [out] time of the next timer invocation (in terms of millis())
+* @return error code
+*/
+esr::error esr::next_deadline(esr::timer_period& deadline)
+{
+	if(_timer_heap_size == 0)
+	{
+		return esr::E_TIMER_NOT_DEFINED;
+	}
+
+	deadline = _timers[_timer_heap[0]].deadline;
 	return esr::E_OK;
 }
 
@@ -389,30 +1925,123 @@ esr::error esr::get_current_thread_id(esr::thread_id& id)
 */
 bool try_process_message(thread_slot& thread)
 {
-	// Pick a message
-	if(thread.queue[0] == esr::MSG_NONE)
+	// Check if there is a message in the queue
+	if(thread.queue_is_empty())
 	{
 		return false;
 	}
 
+	// Pick a message. It is removed from the queue before invocation 
+	// so the thread is able to post new messages to itself
+	esr::message_param param;
+	esr::message msg = thread.dequeue(param);
+	if(thread.queue_is_empty())
+	{
+		_pending_threads &= ~thread_bit(get_thread_id(thread));
+	}
+
 	// Process the message
-	thread.func(thread.queue[0]);
+	dispatch(thread, msg, param);
+
+	return true;
+}
+
+/**
+* Checks if the earliest timer is due
+* @return true if the earliest timer has to be fired
+*/
+bool has_due_timer()
+{
+	return _timer_heap_size > 0 && 
+		!deadline_before(millis(), _timers[_timer_heap[0]].deadline);
+}
 
-	// Move elements in the queue
-	for(uint8_t i = thread.queue_tail; i > 0; --i)
+#ifdef __ESR_ENABLE_TICKLESS_IDLE
+
+/**
+* Checks if anything has to be run regardless of timers
+* @return true if any thread has pending messages (including ones posted from ISRs) or idle loop enabled, 
+* or if there is deferred work or buffered log messages the log stream has room for
+*/
+bool has_ready_threads()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	if(esr::log_drain_ready())
 	{
-		thread.queue[i - 1] = thread.queue[i];
+		return true;
 	}
+#endif
 
-	thread.queue[thread.queue_tail] = esr::MSG_NONE;
+	return _isr_head != _isr_tail || 
+		_pending_threads != 0 || 
+		_idle_threads != 0 ||
+		_work_count != 0;
+}
 
-	// Move queue_tail if possible
-	if(thread.queue_tail > 0)
+/**
+* Puts MCU to sleep until the next interrupt if no thread is ready and no timer is due.
+* Timer0 overflow (millis() tick) wakes MCU up at least once per millisecond, 
+* so the scheduler loop is resumed on time for the next deadline.
+* Host build advances virtual time to the next deadline instead.
+*/
+void idle()
+{
+#ifdef __AVR__
+	// Interrupts are disabled while checking for pending work,
+	// so an interrupt can't slip in between the check and the sleep instruction
+	cli();
+	if(has_ready_threads() || has_due_timer())
 	{
-		--thread.queue_tail;
+		sei();
+		return;
 	}
 
-	return true;
+	// sleep_cpu() is executed before any pending interrupt since sei() takes effect one instruction later
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+#elif defined(__ESR_HOST)
+	// Virtual time jumps to the next timer deadline instead of sleeping
+	if(!has_ready_threads() && !has_due_timer() && _timer_heap_size > 0)
+	{
+		host::sleep_until_ms(_timers[_timer_heap[0]].deadline);
+	}
+#endif
+}
+
+#endif
+
+/**
+* Picks a thread to receive a message: the one with the highest priority among threads 
+* with pending messages that have not been served yet
+* @param served threads that have already received a message within the current iteration
+* @param id [out] thread identifier
+* @return true if a thread has been picked, false if there are no messages to deliver
+*/
+bool pick_ready_thread(esr::thread_mask served, esr::thread_id& id)
+{
+	esr::thread_mask ready = _pending_threads & ~served;
+	if(ready == 0)
+	{
+		return false;
+	}
+
+	// On equal priorities the first thread slot wins
+	uint8_t priority = esr::PRIORITY_HIGH + 1;
+	while(priority > 0)
+	{
+		--priority;
+		esr::thread_mask mask = ready & _priority_threads[priority];
+		if(mask != 0)
+		{
+			id = first_thread(mask);
+			return true;
+		}
+	}
+
+	return false;
 }
 
 /**
@@ -420,43 +2049,395 @@ bool try_process_message(thread_slot& thread)
 */
 void esr::run_cycle()
 {
+#if defined(__ESR_ENABLE_WATCHDOG) && defined(__AVR__)
+	wdt_reset();
+#endif
+
+#ifdef __ESR_ENABLE_TICKLESS_IDLE
+	// Sleep if there's nothing to do until the next timer deadline
+	idle();
+#endif
+
 	_is_in_thread = true;
 
-	// Loop thought thread slots and run each of them
-	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	// Pick up messages posted from ISRs
+	receive_isr_messages();
+
+	// Deliver messages in order of thread priorities. 
+	// The choice is made after each message since handlers might post messages to higher priority threads
+	esr::thread_mask served = 0;
+	esr::thread_id id;
+	uint8_t delivered[esr::MAX_THREADS] = { 0 };
+	bool draining = false;
+	uint32_t drain_start = 0;
+	while(pick_ready_thread(served, id))
 	{
-		thread_slot& thread = _threads[i];
+		_current_thread_id = id;
 
-		// Skip dead threads
-		if(!thread.has_flag(esr::THREAD_ALIVE))
+		// Peek a message from the queue and invoke thread
+		thread_slot& thread = _threads[id];
+		try_process_message(thread);
+
+		// The thread is served once it has received its share of messages.
+		// DRAIN_ALL threads are served once their queues are empty or the budget is spent
+		uint8_t limit = thread.drain_limit;
+		if(limit == 1 || (limit != esr::DRAIN_ALL && ++delivered[id] >= limit))
 		{
+			served |= thread_bit(id);
 			continue;
 		}
 
-		_current_thread_id = i;
-
-		// Try peek a message from the queue and invoke thread
-		try_process_message(thread);
-
-		// If THREAD_IDLE_LOOP flag is set then populate a MSG_IDLE message
-		if(thread.has_flag(esr::THREAD_IDLE_LOOP))
+		// Messages beyond the first one are delivered only within the cycle time budget. 
+		// The budget is counted from the first message of a draining thread, so threads that don't drain pay nothing
+		uint32_t time = micros();
+		if(!draining)
+		{
+			draining = true;
+			drain_start = time;
+		}
+		else if(time - drain_start >= __ESR_DRAIN_BUDGET)
 		{
-			thread.func(esr::MSG_IDLE);
+			served |= thread_bit(id);
 		}
+	}
+
+	// Run idle loops of threads with THREAD_IDLE_LOOP flag set
+	esr::thread_mask idle = _idle_threads;
+	while(idle != 0)
+	{
+		id = first_thread(idle);
+		idle &= idle - 1;
 
-		// If thread has a timer defined then try fire it
-		if(thread.has_flag(esr::THREAD_ENABLE_TIMER))
+		_current_thread_id = id;
+		dispatch(_threads[id], esr::MSG_IDLE, 0);
+
+		// Idle handler might have terminated threads or cleared their flags
+		idle &= _idle_threads;
+	}
+
+	// Fire due timers. Only the earliest deadline has to be checked
+	if(_timer_heap_size > 0)
+	{
+		esr::timer_period time = millis();
+		while(_timer_heap_size > 0)
 		{
-			esr::timer_period time = millis();
-			esr::timer_period interval = time - thread.last_invokation;
+			esr::timer_id timer = _timer_heap[0];
+			if(deadline_before(time, _timers[timer].deadline))
+			{
+				break;
+			}
 
-			// Fire timer if at least thread.period has elapsed
-			if(interval >= thread.period)
+#ifdef __ESR_ENABLE_THREAD_STATS
+			// Timer lateness is actual fire time minus scheduled fire time
+			esr::thread_stats& stats = _threads[_timers[timer].thread].stats;
+			esr::timer_period lateness = time - _timers[timer].deadline;
+			if(lateness > stats.max_timer_lateness)
 			{
-				fire_timer(thread, time);
+				stats.max_timer_lateness = lateness;
 			}
+#endif
+
+			_current_thread_id = _timers[timer].thread;
+			fire_timer(timer, time);
 		}
 	}
 
 	_is_in_thread = false;
-}
\ No newline at end of file
+
+	// Run deferred work only if there's nothing else to do. 
+	// One item per iteration, so messages posted meanwhile are delivered before the rest of the work
+	if(_pending_threads == 0 && _isr_head == _isr_tail && !has_due_timer())
+	{
+		if(_work_count > 0)
+		{
+			run_deferred_work();
+		}
+#ifdef __ESR_ENABLE_LOG_BUFFER
+		else if(esr::log_drain_ready())
+		{
+			// Log messages waited for room in the log stream
+			esr::log_drain();
+		}
+#endif
+	}
+
+#if defined(__ESR_ENABLE_THREAD_STATS) && __ESR_THREAD_STATS_PERIOD > 0
+	// Dump and reset statistics periodically
+	esr::timer_period now = millis();
+	if(now - _stats_dump_time >= __ESR_THREAD_STATS_PERIOD)
+	{
+		_stats_dump_time = now;
+		esr::log_stats();
+		esr::reset_stats();
+	}
+#endif
+}
+
+/**
+* Writes buffered log messages before the next line of a dump, so a dump never overflows the log buffer
+*/
+inline void flush_log_dump()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+}
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+
+/**
+* Gets scheduling statistics of the thread
+* @param id thread identifier
+* @param stats [out] thread statistics
+* @return error code
+*/
+esr::error esr::get_thread_stats(esr::thread_id id, esr::thread_stats& stats)
+{
+	// Retreive thread slot if possible
+	thread_slot* slot_ptr = NULL;
+	esr::error e = get_thread_slot(id, slot_ptr);
+	if(e != esr::E_OK)
+	{
+		return e;
+	}
+
+	stats = slot_ptr->stats;
+	return esr::E_OK;
+}
+
+/**
+* Gets scheduler loop statistics
+* @param stats [out] scheduler loop statistics
+*/
+void esr::get_kernel_stats(esr::kernel_stats& stats)
+{
+	stats.busy_time = _busy_time;
+	stats.total_time = micros() - _stats_start;
+
+	// 16-bit counter is written by ISRs, it has to be read atomically
+#ifdef __AVR__
+	uint8_t sreg = SREG;
+	cli();
+	stats.dropped_isr_messages = _dropped_isr_messages;
+	SREG = sreg;
+#else
+	stats.dropped_isr_messages = _dropped_isr_messages;
+#endif
+}
+
+/**
+* Resets statistics of all threads and the scheduler loop
+*/
+void esr::reset_stats()
+{
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		_threads[i].stats = esr::thread_stats();
+	}
+
+	_busy_time = 0;
+	_stats_start = micros();
+
+#ifdef __AVR__
+	uint8_t sreg = SREG;
+	cli();
+	_dropped_isr_messages = 0;
+	SREG = sreg;
+#else
+	_dropped_isr_messages = 0;
+#endif
+}
+
+/**
+* Writes statistics of all alive threads and the scheduler loop into log
+*/
+void esr::log_stats()
+{
+	for(uint8_t i = 0; i < esr::MAX_THREADS; ++i)
+	{
+		const thread_slot& thread = _threads[i];
+		if(!thread.has_flag(esr::THREAD_ALIVE))
+		{
+			continue;
+		}
+
+		const esr::thread_stats& stats = thread.stats;
+		flush_log_dump();
+		esr::log(esr::LOG_INFO, F("ESR\tthread %ub: calls=%ul time=%ul max=%ul late=%ul queue=%ub dropped=%ud overruns=%ud"), 
+			i, 
+			&stats.dispatch_count, 
+			&stats.total_time, 
+			&stats.max_time, 
+			&stats.max_timer_lateness, 
+			stats.queue_high_water, 
+			stats.dropped_messages, 
+			stats.budget_overruns);
+	}
+
+	esr::kernel_stats stats;
+	esr::get_kernel_stats(stats);
+
+	// Avoid 32-bit overflow of busy_time * 100
+	uint32_t percent = stats.total_time / 100;
+	uint8_t load = percent > 0 
+		? static_cast<uint8_t>(stats.busy_time / percent) 
+		: 0;
+	uint32_t idle_time = stats.total_time - stats.busy_time;
+
+	flush_log_dump();
+	esr::log(esr::LOG_INFO, F("ESR\tload=%ub%% busy=%ul idle=%ul dropped_isr=%ud"), 
+		load, 
+		&stats.busy_time, 
+		&idle_time, 
+		stats.dropped_isr_messages);
+}
+
+#endif
+
+/**
+* RAM taken by kernel parts in the current configuration, in bytes
+*/
+const uint16_t RAM_THREADS = sizeof(_threads);
+const uint16_t RAM_MAILBOXES = sizeof(_mailbox_queue) + sizeof(_mailbox_params);
+const uint16_t RAM_TIMERS = sizeof(_timers) + sizeof(_timer_heap);
+const uint16_t RAM_MASKS = sizeof(_topics) + sizeof(_coalesced_messages) + 
+	sizeof(_pending_threads) + sizeof(_idle_threads) + sizeof(_priority_threads);
+const uint16_t RAM_ISR = sizeof(_isr_queue);
+const uint16_t RAM_WORK = sizeof(_work_queue);
+#ifdef __ESR_ENABLE_TRACE
+const uint16_t RAM_TRACE = sizeof(_trace);
+#else
+const uint16_t RAM_TRACE = 0;
+#endif
+#ifdef __ESR_ENABLE_LOG_BUFFER
+const uint16_t RAM_LOG_BUFFER = __ESR_LOG_BUFFER;
+#else
+const uint16_t RAM_LOG_BUFFER = 0;
+#endif
+const uint16_t RAM_TOTAL = RAM_THREADS + RAM_MAILBOXES + RAM_TIMERS + RAM_MASKS + 
+	RAM_ISR + RAM_WORK + RAM_TRACE + RAM_LOG_BUFFER;
+
+/**
+* Compile-time check of the kernel RAM budget. Only a passed check is a complete type, 
+* a failed one stops the build with both sizes in the message, ex. "incomplete type ram_budget_check<600, 512, false>"
+*/
+template<uint16_t total, uint16_t budget, bool passed> struct ram_budget_check;
+template<uint16_t total, uint16_t budget> struct ram_budget_check<total, budget, true>
+{
+};
+
+#ifdef __AVR__
+// Costs in esr_conf.h are for AVR, other platforms have wider pointers and padding
+typedef char ram_budget_report[sizeof(ram_budget_check<RAM_TOTAL, __ESR_RAM_BUDGET, RAM_TOTAL <= __ESR_RAM_BUDGET>)];
+#endif
+
+/**
+* Writes RAM usage of the kernel into log. All sizes are compile-time constants of the current configuration
+*/
+void esr::log_memory_usage()
+{
+	flush_log_dump();
+	esr::log(esr::LOG_INFO, F("ESR\tram: threads=%ud mailboxes=%ud timers=%ud masks=%ud isr=%ud work=%ud trace=%ud log=%ud total=%ud"), 
+		RAM_THREADS, 
+		RAM_MAILBOXES, 
+		RAM_TIMERS, 
+		RAM_MASKS, 
+		RAM_ISR, 
+		RAM_WORK, 
+		RAM_TRACE, 
+		RAM_LOG_BUFFER, 
+		RAM_TOTAL);
+}
+
+#ifdef __ESR_ENABLE_WATCHDOG
+
+/**
+* Enables AVR watchdog
+*/
+void esr::watchdog_init()
+{
+#ifdef __AVR__
+	// Only a watchdog reset is caused by a thread, not the reset button or a programmer. 
+	// Optiboot leaves its bootloader by a watchdog reset, EXTRF tells such a reset apart. 
+	// Power-on and brown-out resets leave garbage in .noinit section
+	const uint8_t causes = _BV(WDRF) | _BV(EXTRF) | _BV(PORF) | _BV(BORF);
+	if(_dispatch_record.marker == DISPATCH_IN_PROGRESS && (_reset_flags & causes) == _BV(WDRF))
+	{
+		_reset_culprit = _dispatch_record;
+	}
+
+	_dispatch_record.marker = 0;
+	wdt_enable(__ESR_WATCHDOG_TIMEOUT);
+#endif
+}
+
+/**
+* Gets the thread that has been running when MCU was reset
+* @param id [out] thread identifier
+* @param msg [out] message code the thread has been invoked with
+* @return error code
+*/
+esr::error esr::get_reset_culprit(esr::thread_id& id, esr::message& msg)
+{
+	if(_reset_culprit.marker != DISPATCH_IN_PROGRESS)
+	{
+		return esr::E_NO_RESET_CULPRIT;
+	}
+
+	id = _reset_culprit.id;
+	msg = _reset_culprit.msg;
+	return esr::E_OK;
+}
+
+#endif
+
+#ifdef __ESR_ENABLE_TRACE
+
+/**
+* Writes a byte as two hex digits
+* @param out output stream
+* @param value byte value
+*/
+void print_hex(Print& out, uint8_t value)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	out.print(digits[value >> 4]);
+	out.print(digits[value & 0x0F]);
+}
+
+/**
+* Writes recorded trace events as text and clears the trace buffer
+* @param out output stream
+*/
+void esr::trace_dump(Print& out)
+{
+	uint8_t head = _trace_head;
+	uint8_t count = _trace_count;
+	_trace_count = 0;
+
+	out.print(F("ESR TRACE "));
+	out.print(count);
+	out.print(' ');
+	out.print(_trace_start);
+	out.println();
+
+	for(uint8_t n = 0; n < count; ++n)
+	{
+		const trace_event& e = _trace[head];
+		print_hex(out, static_cast<uint8_t>(e.time >> 8));
+		print_hex(out, static_cast<uint8_t>(e.time));
+		print_hex(out, e.type);
+		print_hex(out, e.thread);
+		print_hex(out, e.msg);
+		out.println();
+
+		if(++head >= __ESR_TRACE_BUFFER)
+		{
+			head = 0;
+		}
+	}
+
+	out.println(F("ESR TRACE END"));
+}
+
+#endif
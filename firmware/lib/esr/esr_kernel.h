@@ -22,12 +22,27 @@ namespace esr
 	*/
 	const uint8_t MAX_THREAD_QUEUE = __ESR_MAX_THREAD_QUEUE;
 
+	/**
+	* Defines total amount of message queue entries of all threads
+	*/
+	const uint8_t MAILBOX_POOL = __ESR_MAILBOX_POOL;
+
 
 	/**
 	* Message code
 	*/
 	typedef uint8_t message;
 
+	/**
+	* Defines amount of message codes that might be coalesced
+	*/
+	const uint8_t MAX_COALESCED_MESSAGES = __ESR_COALESCED_MESSAGES;
+
+	/**
+	* Message parameter. A small payload delivered along with a message code
+	*/
+	typedef uint32_t message_param;
+
 	/**
 	* Empty message code
 	*/
@@ -64,6 +79,54 @@ namespace esr
 	*/
 	const thread_id THREAD_CURRENT = 255;
 
+	/**
+	* Thread bit mask, one bit per thread slot
+	*/
+#if __ESR_MAX_THREADS <= 8
+	typedef uint8_t thread_mask;
+#elif __ESR_MAX_THREADS <= 16
+	typedef uint16_t thread_mask;
+#elif __ESR_MAX_THREADS <= 32
+	typedef uint32_t thread_mask;
+#else
+#error __ESR_MAX_THREADS must not exceed 32
+#endif
+
+	/**
+	* Defines maximum allowed amount of topics
+	*/
+	const uint8_t MAX_TOPICS = __ESR_MAX_TOPICS;
+
+	/**
+	* Topic identifier
+	*/
+	typedef uint8_t topic_id;
+
+	/**
+	* Thread priority. Threads with higher priority receive their messages first
+	*/
+	typedef uint8_t thread_priority;
+
+	/**
+	* Low thread priority (background work)
+	*/
+	const thread_priority PRIORITY_LOW = 0;
+
+	/**
+	* Normal thread priority. This is a default priority of a new thread
+	*/
+	const thread_priority PRIORITY_NORMAL = 1;
+
+	/**
+	* High thread priority (user interaction)
+	*/
+	const thread_priority PRIORITY_HIGH = 2;
+
+	/**
+	* Drain limit value: the thread receives all of its pending messages within a scheduler loop iteration
+	*/
+	const uint8_t DRAIN_ALL = 0;
+
 	/**
 	* Thread option flags
 	*/
@@ -111,16 +174,126 @@ namespace esr
 	typedef uint32_t timer_period;
 
 	/**
-	* Thread worker function type
+	* Defines maximum allowed amount of timers created by esr::create_timer()
+	*/
+	const uint8_t MAX_TIMERS = __ESR_MAX_TIMERS;
+
+	/**
+	* Timer identifier
+	*/
+	typedef uint8_t timer_id;
+
+	/**
+	* Defines behavior of a periodic timer that has missed one or more deadlines (ex. due to a long thread function).
+	* In any case the next deadline is counted from the previous one, so the timer doesn't drift.
+	*/
+	enum catch_up_policy
+	{
+		/**
+		* Missed invocations are skipped, the timer fires at the next deadline in its schedule
+		*/
+		CATCH_UP_SKIP,
+
+		/**
+		* Every missed invocation is delivered, back to back
+		*/
+		CATCH_UP_BURST,
+
+		/**
+		* The schedule is restarted: the next deadline is one period after the actual invocation
+		*/
+		CATCH_UP_RESTART
+	};
+
+	/**
+	* Thread worker function type. 
+	* System messages (MSG_IDLE, MSG_TIMER, MSG_FINALIZE) are delivered with zero parameter.
+	*/
+	typedef void (*thread_func)(message msg, message_param param);
+
+	/**
+	* Defines maximum allowed amount of pending deferred work items
+	*/
+	const uint8_t MAX_DEFERRED_WORK = __ESR_DEFERRED_WORK_QUEUE;
+
+	/**
+	* Deferred work function type
+	*/
+	typedef void (*work_func)(message_param param);
+
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+
+	/**
+	* Thread scheduling statistics
 	*/
-	typedef void (*thread_func)(message msg);
+	struct thread_stats
+	{
+		/**
+		* Amount of thread function invocations (messages, idle loops and timers)
+		*/
+		uint32_t dispatch_count;
+
+		/**
+		* Total time spent in thread function, in microseconds
+		*/
+		uint32_t total_time;
+
+		/**
+		* The longest thread function invocation, in microseconds
+		*/
+		uint32_t max_time;
 
+		/**
+		* The longest delay of a timer invocation after its deadline, in milliseconds
+		*/
+		uint32_t max_timer_lateness;
+
+		/**
+		* Amount of messages rejected because the message queue was full
+		*/
+		uint16_t dropped_messages;
+
+		/**
+		* Amount of thread function invocations longer than thread's time budget
+		*/
+		uint16_t budget_overruns;
+
+		/**
+		* The highest amount of pending messages in the message queue
+		*/
+		uint8_t queue_high_water;
+	};
 
 	/**
-	* Starts new thread
+	* Scheduler loop statistics
+	*/
+	struct kernel_stats
+	{
+		/**
+		* Time spent in thread functions, in microseconds
+		*/
+		uint32_t busy_time;
+
+		/**
+		* Time elapsed since statistics have been reset, in microseconds
+		*/
+		uint32_t total_time;
+
+		/**
+		* Amount of messages rejected because the interrupt message queue was full
+		*/
+		uint16_t dropped_isr_messages;
+	};
+
+#endif
+
+	/**
+	* Starts new thread. 
+	* The thread takes up to MAX_THREAD_QUEUE free entries of the mailbox pool for its message queue
 	* @param thread thread entry point
 	* @param [out] an identifier of a new thread
-	* @return error code
+	* @return error code, E_NO_FREE_THREAD_SLOTS if all thread slots or all mailbox pool entries are taken
 	*/
 	error begin_thread(thread_func thread, thread_id& id);
 
@@ -142,6 +315,41 @@ namespace esr
 	*/
 	error set_thread_flag(thread_id id, thread_flags flag, bool value);
 
+	/**
+	* Sets thread priority. 
+	* Within a scheduler loop iteration messages are delivered to threads in order of their priorities, 
+	* each thread receives at most one message per iteration so low priority threads can't be starved.
+	* @param id thread identifier
+	* @param priority thread priority, from PRIORITY_LOW to PRIORITY_HIGH
+	* @return error code
+	*/
+	error set_thread_priority(thread_id id, thread_priority priority);
+
+	/**
+	* Sets amount of messages the thread receives within one scheduler loop iteration. 
+	* By default each thread receives one message per iteration. 
+	* Higher limits reduce latency of message bursts. Messages beyond the first one are delivered only within 
+	* __ESR_DRAIN_BUDGET microseconds since draining has begun in the iteration, so other threads don't starve.
+	* Higher priority threads still receive their messages first.
+	* @param id thread identifier
+	* @param limit maximum amount of messages per iteration, DRAIN_ALL to drain the queue
+	* @return error code, E_WRONG_THREAD if the thread identifier is wrong or the thread is not alive
+	*/
+	error set_thread_drain(thread_id id, uint8_t limit);
+
+#ifdef __ESR_ENABLE_TIME_BUDGETS
+
+	/**
+	* Sets thread time budget. Thread function invocations longer than the budget are logged (LOG_ERROR level).
+	* By default each thread has a budget of __ESR_DEFAULT_TIME_BUDGET milliseconds.
+	* @param id thread identifier
+	* @param budget time budget in milliseconds, 0 disables the check
+	* @return error code
+	*/
+	error set_thread_time_budget(thread_id id, uint16_t budget);
+
+#endif
+
 	/**
 	* Terminates thread
 	* @param id thread identifier
@@ -153,12 +361,148 @@ namespace esr
 	* Puts a message into thread's message queue
 	* @param id thread identifier
 	* @param msg message code
+	* @param param message parameter
 	* @return error code
 	*/
-	error post_message(thread_id id, message msg);
+	error post_message(thread_id id, message msg, message_param param = 0);
+
+	/**
+	* Enables or disables coalescing of the message code. 
+	* Posting a coalesced message that is already pending in thread's message queue succeeds without 
+	* taking another queue entry, the pending message receives the new parameter value. 
+	* This is intended for idempotent notifications ("something has changed", "redraw").
+	* @param msg message code, from MSG_USER to MAX_COALESCED_MESSAGES - 1
+	* @param value true to enable coalescing, false to disable it
+	* @return error code
+	*/
+	error set_message_coalescing(message msg, bool value);
+
+	/**
+	* Puts a message into thread's message queue after the specified delay. 
+	* Pending deliveries take timers from the same pool as esr::create_timer().
+	* @param id thread identifier
+	* @param msg message code
+	* @param delay delay in milliseconds
+	* @param param message parameter
+	* @return error code, E_NO_FREE_TIMERS if there are too many pending deliveries
+	*/
+	error post_message_after(thread_id id, message msg, timer_period delay, message_param param = 0);
+
+	/**
+	* Puts a message into thread's message queue at the specified time
+	* @param id thread identifier
+	* @param msg message code
+	* @param time delivery time (in terms of millis())
+	* @param param message parameter
+	* @return error code, E_NO_FREE_TIMERS if there are too many pending deliveries
+	*/
+	error post_message_at(thread_id id, message msg, timer_period time, message_param param = 0);
+
+	/**
+	* Cancels pending deliveries of the message posted by esr::post_message_after() or esr::post_message_at()
+	* @param id thread identifier
+	* @param msg message code
+	* @return error code
+	*/
+	error cancel_message(thread_id id, message msg);
+
+	/**
+	* Puts a message into thread's message queue from an interrupt service routine.
+	* Messages are passed through a lock-free queue and are moved into thread's message queue 
+	* at the beginning of the next scheduler loop iteration.
+	* Interrupts don't nest on AVR so all ISRs together act as a single producer. 
+	* This function must not be called from outside of ISRs unless interrupts are disabled.
+	* @param id thread identifier (esr::THREAD_CURRENT is not allowed)
+	* @param msg message code
+	* @param param message parameter
+	* @return error code
+	*/
+	error post_message_from_isr(thread_id id, message msg, message_param param = 0);
+
+	/**
+	* Puts a work item into the deferred work queue. Work items are run in order, one per scheduler loop iteration, 
+	* only when no thread has pending messages and no timer is due, so slow bookkeeping (ex. EEPROM writes) 
+	* doesn't delay message handling. Work functions are invoked outside of thread context.
+	* A work item that is already pending (same function and parameter) is not queued twice.
+	* @param func work function
+	* @param param work function parameter
+	* @return error code, E_WORK_QUEUE_IS_FULL if there are too many pending work items
+	*/
+	error defer(work_func func, message_param param = 0);
+
+	/**
+	* Subscribes thread to a topic. Messages published into the topic will be posted to the thread
+	* @param id thread identifier
+	* @param topic topic identifier
+	* @return error code
+	*/
+	error subscribe(thread_id id, topic_id topic);
+
+	/**
+	* Unsubscribes thread from a topic
+	* @param id thread identifier
+	* @param topic topic identifier
+	* @return error code
+	*/
+	error unsubscribe(thread_id id, topic_id topic);
+
+	/**
+	* Posts a message to every thread subscribed to the topic.
+	* Delivery to the rest of subscribers continues if a subscriber's message queue is full.
+	* @param topic topic identifier
+	* @param msg message code
+	* @param param message parameter
+	* @return error code, E_MESSAGE_QUEUE_IS_FULL if the message has not been delivered to some subscribers
+	*/
+	error publish(topic_id topic, message msg, message_param param = 0);
+
+	/**
+	* Changes message queue capacity of the thread. 
+	* Message queues of all threads share MAILBOX_POOL entries, so shrinking queues of threads 
+	* that receive few messages right after esr::begin_thread() leaves more entries for the next threads.
+	* @param id thread identifier
+	* @param size new queue capacity, from 1 to MAX_THREAD_QUEUE
+	* @return error code, E_WRONG_QUEUE_SIZE if pending messages or other threads' queues leave no room for the new size
+	*/
+	error set_thread_queue_size(thread_id id, uint8_t size);
+
+	/**
+	* Creates a timer. A thread might own several timers, each one delivers its own message code. 
+	* Timers are deleted automatically when their thread terminates.
+	* @param id thread identifier
+	* @param msg message code to be delivered by the timer
+	* @param timer [out] timer identifier
+	* @return error code
+	*/
+	error create_timer(thread_id id, message msg, timer_id& timer);
+
+	/**
+	* Starts (or restarts) a timer
+	* @param timer timer identifier
+	* @param delay time until the first invocation in milliseconds (0 fires the timer on the next scheduler loop iteration)
+	* @param period timer period in milliseconds, 0 for one-shot timer
+	* @param policy behavior of a periodic timer that has missed its deadlines
+	* @return error code
+	*/
+	error start_timer(timer_id timer, timer_period delay, timer_period period = 0, catch_up_policy policy = CATCH_UP_SKIP);
+
+	/**
+	* Stops a timer
+	* @param timer timer identifier
+	* @return error code
+	*/
+	error stop_timer(timer_id timer);
+
+	/**
+	* Stops and deletes a timer
+	* @param timer timer identifier
+	* @return error code
+	*/
+	error delete_timer(timer_id timer);
 
 	/**
 	* Starts timer for the thread. Timer's behavior depends on THREAD_REPEAT_TIMER flag.
+	* This is a thread's own timer delivering MSG_TIMER message, it doesn't drift (missed invocations are skipped).
 	* @param id thread identifier
 	* @param period timer period in milliseconds
 	* @return error code
@@ -166,7 +510,7 @@ namespace esr
 	error set_timer_ms(thread_id id, timer_period period);	
 
 	/**
-	* Changes timer period for the thread. 
+	* Changes timer period for the thread. The next invocation is counted from the previous scheduled one.
 	* If THREAD_REPEAT_TIMER flag is not set and timer has already fired then this function will have no effect 
 	* (since THREAD_ENABLE_TIMER flag will be cleared at that moment).
 	* @param id thread identifier
@@ -182,6 +526,13 @@ namespace esr
 	*/
 	error clear_timer(thread_id id);
 
+	/**
+	* Gets the earliest deadline among all armed timers
+	* @param deadline [out] time of the next timer invocation (in terms of millis())
+	* @return error code
+	*/
+	error next_deadline(timer_period& deadline);
+
 	/**
 	* Gets an identifier of the current thread
 	* @param id [out] current thread identifier
@@ -189,6 +540,115 @@ namespace esr
 	*/
 	error get_current_thread_id(thread_id& id);
 
+#ifdef __ESR_ENABLE_WATCHDOG
+
+	/**
+	* Enables AVR watchdog with __ESR_WATCHDOG_TIMEOUT timeout. Must be called at the beginning of setup().
+	* Scheduler loop resets the watchdog before each thread function invocation, 
+	* so a thread function that doesn't return within the timeout resets MCU.
+	*/
+	void watchdog_init();
+
+	/**
+	* Gets the thread that has been running when the watchdog reset MCU. 
+	* Other resets (power-on, brown-out, reset button) are not attributed to threads. 
+	* Reset flags are taken from MCUSR or, if a bootloader has cleared it, from r2 (Optiboot 5+ passes them there).
+	* @param id [out] thread identifier
+	* @param msg [out] message code the thread has been invoked with
+	* @return error code, E_NO_RESET_CULPRIT if MCU hasn't been reset during a thread function invocation
+	*/
+	error get_reset_culprit(thread_id& id, message& msg);
+
+#endif
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+
+	/**
+	* Gets scheduling statistics of the thread
+	* @param id thread identifier
+	* @param stats [out] thread statistics
+	* @return error code
+	*/
+	error get_thread_stats(thread_id id, thread_stats& stats);
+
+	/**
+	* Gets scheduler loop statistics. 
+	* Idle time is total_time - busy_time
+	* @param stats [out] scheduler loop statistics
+	*/
+	void get_kernel_stats(kernel_stats& stats);
+
+	/**
+	* Resets statistics of all threads and the scheduler loop
+	*/
+	void reset_stats();
+
+	/**
+	* Writes statistics of all alive threads and the scheduler loop into log (LOG_INFO level).
+	* esr::run_cycle() calls this function and resets statistics every __ESR_THREAD_STATS_PERIOD milliseconds
+	*/
+	void log_stats();
+
+#endif
+
+	/**
+	* Writes RAM usage of the kernel into log (LOG_INFO level): sizes of thread slots, mailbox pool, timers, 
+	* topics, interrupt message queue, deferred work queue and trace buffer for the current configuration
+	*/
+	void log_memory_usage();
+
+#ifdef __ESR_ENABLE_TRACE
+
+	/**
+	* Kernel trace event type
+	*/
+	enum trace_event_type
+	{
+		/**
+		* Time synchronization: the event carries bits 20..31 of micros() instead of thread and message.
+		* It is recorded before an event that comes 2^20 us or more after the previous one 
+		* so 16-bit timestamps can be unwrapped
+		*/
+		TRACE_SYNC,
+
+		/**
+		* A message has been put into thread's message queue
+		*/
+		TRACE_POST,
+
+		/**
+		* Thread function invocation has begun
+		*/
+		TRACE_DISPATCH_BEGIN,
+
+		/**
+		* Thread function invocation has ended
+		*/
+		TRACE_DISPATCH_END,
+
+		/**
+		* Thread's timer has fired
+		*/
+		TRACE_TIMER,
+
+		/**
+		* A message has been dropped since thread's message queue is full
+		*/
+		TRACE_QUEUE_FULL
+	};
+
+	/**
+	* Writes recorded trace events as text and clears the trace buffer.
+	* The dump is a "ESR TRACE <count> <time of the first event in us>" line followed by one line per event 
+	* and a "ESR TRACE END" line.
+	* An event line is 10 hex digits: timestamp (micros() / 16, 16 bits), type, thread and message (8 bits each).
+	* Use extras/trace/esr_trace.py to convert a dump into a Chrome trace (chrome://tracing, Perfetto)
+	* @param out output stream
+	*/
+	void trace_dump(Print& out);
+
+#endif
+
 	/**
 	* Runs one iteration of scheduler loop
 	*/
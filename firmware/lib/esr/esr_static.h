@@ -0,0 +1,294 @@
+#ifndef _ESR_STATIC_h
+#define _ESR_STATIC_h
+
+#include "esr_kernel.h"
+
+/*
+* Static kernel:
+* ==============
+* An alternative to esr::begin_thread()/esr::run_cycle() for applications with a thread set known at compile time.
+* Each thread is a type derived from esr::static_thread<> with a static thread_func().
+* Thread identifier is a position of the thread in the esr::static_kernel<> argument list.
+*
+*	struct blink : esr::static_thread<2>
+*	{
+*		static void thread_func(esr::message msg, esr::message_param param);
+*	};
+*
+*	typedef esr::static_kernel<blink, gui> kernel;
+*
+*	kernel::post<blink>(MSG_BLINK);
+*	kernel::run_cycle();
+*
+* Mailboxes are sized per thread, dispatch is unrolled by the compiler and there are no dead slots to scan.
+* Each position of each kernel has its own mailbox, so a thread type might be used in several kernels 
+* or several times in one kernel. post<T>() requires T to be in the thread list once, post_message() takes any position.
+* Static kernel doesn't support timers, topics and ISR messages, use the dynamic kernel for such threads.
+*/
+
+namespace esr
+{
+	/**
+	* Base type of static kernel threads
+	* @param QueueSize mailbox capacity (1..255)
+	* @param IdleLoop true if the thread receives MSG_IDLE message on each scheduler loop iteration
+	*/
+	template<uint8_t QueueSize, bool IdleLoop = false>
+	struct static_thread
+	{
+		static const uint8_t queue_size = QueueSize;
+		static const bool idle_loop = IdleLoop;
+	};
+
+	/**
+	* An empty position in static kernel's thread list
+	*/
+	struct no_thread : static_thread<1>
+	{
+		static void thread_func(message msg, message_param param)
+		{
+		}
+	};
+
+	/**
+	* Mailbox of a static kernel thread
+	* @param Kernel kernel type
+	* @param Slot thread position in the kernel's thread list
+	* @param T thread type
+	*/
+	template<class Kernel, uint8_t Slot, class T>
+	class static_mailbox
+	{
+	public:
+		/**
+		* Puts a message at the tail of the mailbox
+		* @param msg message code
+		* @param param message parameter
+		* @return error code
+		*/
+		static error post(message msg, message_param param)
+		{
+			if(msg == MSG_NONE || msg == MSG_IDLE || msg == MSG_TIMER)
+			{
+				return E_WRONG_MESSAGE;
+			}
+
+			if(_count >= T::queue_size)
+			{
+				return E_MESSAGE_QUEUE_IS_FULL;
+			}
+
+			uint8_t tail = _head + _count;
+			if(tail >= T::queue_size)
+			{
+				tail -= T::queue_size;
+			}
+
+			_queue[tail] = msg;
+			_params[tail] = param;
+			++_count;
+			return E_OK;
+		}
+
+		/**
+		* Delivers a message from the head of the mailbox to the thread (if any)
+		*/
+		static void deliver()
+		{
+			if(_count == 0)
+			{
+				return;
+			}
+
+			// The message is removed before invocation so the thread is able to post messages to itself
+			message msg = _queue[_head];
+			message_param param = _params[_head];
+
+			++_head;
+			if(_head >= T::queue_size)
+			{
+				_head = 0;
+			}
+
+			--_count;
+
+			T::thread_func(msg, param);
+		}
+
+		/**
+		* Invokes the thread with MSG_IDLE message if it has idle loop enabled
+		*/
+		static void idle()
+		{
+			if(T::idle_loop)
+			{
+				T::thread_func(MSG_IDLE, 0);
+			}
+		}
+
+	private:
+		static message _queue[T::queue_size];
+		static message_param _params[T::queue_size];
+		static uint8_t _head;
+		static uint8_t _count;
+	};
+
+	template<class Kernel, uint8_t Slot, class T> message static_mailbox<Kernel, Slot, T>::_queue[T::queue_size];
+	template<class Kernel, uint8_t Slot, class T> message_param static_mailbox<Kernel, Slot, T>::_params[T::queue_size];
+	template<class Kernel, uint8_t Slot, class T> uint8_t static_mailbox<Kernel, Slot, T>::_head;
+	template<class Kernel, uint8_t Slot, class T> uint8_t static_mailbox<Kernel, Slot, T>::_count;
+
+	/**
+	* Empty thread list positions have no mailbox
+	*/
+	template<class Kernel, uint8_t Slot>
+	class static_mailbox<Kernel, Slot, no_thread>
+	{
+	public:
+		static error post(message msg, message_param param)
+		{
+			return E_WRONG_THREAD;
+		}
+
+		static void deliver()
+		{
+		}
+
+		static void idle()
+		{
+		}
+	};
+
+	/**
+	* Tells if two types are the same: value is 1 if they are, 0 otherwise
+	*/
+	template<class A, class B>
+	struct static_same_type
+	{
+		static const uint8_t value = 0;
+	};
+
+	template<class A>
+	struct static_same_type<A, A>
+	{
+		static const uint8_t value = 1;
+	};
+
+	/**
+	* Compile-time check of static_kernel::post<T>(). Only the true specialization is defined, so a thread type 
+	* that is missing from the thread list or appears in it more than once fails the build with this type in the message
+	*/
+	template<bool passed> struct static_thread_is_unique;
+	template<> struct static_thread_is_unique<true> {};
+
+	/**
+	* Scheduler with a thread set defined at compile time.
+	* Threads receive messages in order of their positions in the argument list
+	*/
+	template<
+		class T0,
+		class T1 = no_thread,
+		class T2 = no_thread,
+		class T3 = no_thread,
+		class T4 = no_thread,
+		class T5 = no_thread,
+		class T6 = no_thread,
+		class T7 = no_thread>
+	class static_kernel
+	{
+	public:
+		/**
+		* Puts a message into thread's mailbox
+		* @param T thread type, it must appear in the thread list once
+		* @param msg message code
+		* @param param message parameter
+		* @return error code
+		*/
+		template<class T>
+		static error post(message msg, message_param param = 0)
+		{
+			(void)sizeof(static_thread_is_unique<slot_of<T>::count == 1>);
+			return static_mailbox<static_kernel, slot_of<T>::value, T>::post(msg, param);
+		}
+
+		/**
+		* Puts a message into thread's mailbox
+		* @param id thread identifier (position in the thread list)
+		* @param msg message code
+		* @param param message parameter
+		* @return error code
+		*/
+		static error post_message(thread_id id, message msg, message_param param = 0)
+		{
+			switch(id)
+			{
+			case 0: return static_mailbox<static_kernel, 0, T0>::post(msg, param);
+			case 1: return static_mailbox<static_kernel, 1, T1>::post(msg, param);
+			case 2: return static_mailbox<static_kernel, 2, T2>::post(msg, param);
+			case 3: return static_mailbox<static_kernel, 3, T3>::post(msg, param);
+			case 4: return static_mailbox<static_kernel, 4, T4>::post(msg, param);
+			case 5: return static_mailbox<static_kernel, 5, T5>::post(msg, param);
+			case 6: return static_mailbox<static_kernel, 6, T6>::post(msg, param);
+			case 7: return static_mailbox<static_kernel, 7, T7>::post(msg, param);
+			default: return E_WRONG_THREAD;
+			}
+		}
+
+		/**
+		* Runs one iteration of scheduler loop:
+		* delivers at most one message to each thread, then runs idle loops
+		*/
+		static void run_cycle()
+		{
+			static_mailbox<static_kernel, 0, T0>::deliver();
+			static_mailbox<static_kernel, 1, T1>::deliver();
+			static_mailbox<static_kernel, 2, T2>::deliver();
+			static_mailbox<static_kernel, 3, T3>::deliver();
+			static_mailbox<static_kernel, 4, T4>::deliver();
+			static_mailbox<static_kernel, 5, T5>::deliver();
+			static_mailbox<static_kernel, 6, T6>::deliver();
+			static_mailbox<static_kernel, 7, T7>::deliver();
+
+			static_mailbox<static_kernel, 0, T0>::idle();
+			static_mailbox<static_kernel, 1, T1>::idle();
+			static_mailbox<static_kernel, 2, T2>::idle();
+			static_mailbox<static_kernel, 3, T3>::idle();
+			static_mailbox<static_kernel, 4, T4>::idle();
+			static_mailbox<static_kernel, 5, T5>::idle();
+			static_mailbox<static_kernel, 6, T6>::idle();
+			static_mailbox<static_kernel, 7, T7>::idle();
+		}
+
+	private:
+		/**
+		* Position of a thread type in the thread list
+		* @param T thread type
+		*/
+		template<class T>
+		struct slot_of
+		{
+			/**
+			* Amount of positions taken by the type
+			*/
+			static const uint8_t count = 
+				static_same_type<T, T0>::value + static_same_type<T, T1>::value + 
+				static_same_type<T, T2>::value + static_same_type<T, T3>::value + 
+				static_same_type<T, T4>::value + static_same_type<T, T5>::value + 
+				static_same_type<T, T6>::value + static_same_type<T, T7>::value;
+
+			/**
+			* The first position taken by the type
+			*/
+			static const uint8_t value = 
+				static_same_type<T, T0>::value ? 0 : 
+				static_same_type<T, T1>::value ? 1 : 
+				static_same_type<T, T2>::value ? 2 : 
+				static_same_type<T, T3>::value ? 3 : 
+				static_same_type<T, T4>::value ? 4 : 
+				static_same_type<T, T5>::value ? 5 : 
+				static_same_type<T, T6>::value ? 6 : 7;
+		};
+	};
+}
+
+#endif
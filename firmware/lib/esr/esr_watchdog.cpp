@@ -0,0 +1,37 @@
+#include "esr_kernel.h"
+
+/*
+* Startup code of watchdog support. It is kept apart from esr_kernel.cpp: a library archive
+* links this object only along with the kernel (esr::watchdog_init() takes _reset_flags),
+* so a sketch that uses esr_format.h alone keeps its own reset flags and watchdog state
+*/
+
+#if defined(__ESR_ENABLE_WATCHDOG) && defined(__AVR__)
+
+#include <avr/wdt.h>
+
+/**
+* Reset cause flags (MCUSR value on startup)
+*/
+uint8_t _reset_flags __attribute__((section(".noinit")));
+
+/**
+* Saves reset cause flags before the C runtime starts and stops the watchdog left enabled by a watchdog reset.
+* Optiboot clears MCUSR and passes its value in r2 instead, so r2 is taken if MCUSR is empty.
+* Older Optiboot versions (ex. 4.4) don't pass it, resets are never attributed to threads then
+*/
+void save_reset_flags() __attribute__((naked, used, section(".init3")));
+void save_reset_flags()
+{
+	uint8_t flags = MCUSR;
+	if(flags == 0)
+	{
+		__asm__ __volatile__("mov %0, r2" : "=r" (flags));
+	}
+
+	_reset_flags = flags;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+#endif
@@ -0,0 +1,521 @@
+#include <esr.h>
+
+const esr::message MSG_PING = esr::MSG_USER + 0;
+
+/**
+* Amount of messages to post and drain
+*/
+const uint32_t MESSAGE_COUNT = 1000000;
+
+/**
+* Amount of scheduler loop iterations to run
+*/
+const uint32_t CYCLE_COUNT = 100000;
+
+/**
+* Amount of threads in kernel benchmarks (as many as in weatherhub firmware)
+*/
+const uint8_t KERNEL_THREADS = 5;
+
+/**
+* Amount of log messages to write
+*/
+const uint32_t LOG_COUNT = 100000;
+
+/**
+* Amount of numbers to format
+*/
+const uint32_t FORMAT_COUNT = 100000;
+
+/**
+* Amount of message bursts in drain benchmarks
+*/
+const uint32_t BURST_COUNT = 10000;
+
+/**
+* Amount of messages in a burst
+*/
+const uint8_t BURST_SIZE = 4;
+
+/**
+* Time a busy thread takes to process a message, in microseconds
+*/
+const uint32_t BUSY_TIME = 20;
+
+esr::thread_id sink_thread_id;
+uint32_t received;
+
+/**
+* Sum of parameters of received messages. Benchmarks print it, so the compiler can't drop message delivery
+*/
+uint32_t checksum;
+
+/**
+* Total and maximum latency of messages received by latency_thread(), in microseconds
+*/
+uint32_t total_latency;
+uint32_t max_latency;
+
+void sink_thread(esr::message msg, esr::message_param param)
+{
+	switch (msg)
+	{
+	case MSG_PING:
+		++received;
+		checksum += param;
+		break;
+	}
+}
+
+/**
+* Receives messages with their post time as a parameter and accounts queueing delay
+*/
+void latency_thread(esr::message msg, esr::message_param param)
+{
+	switch (msg)
+	{
+	case MSG_PING:
+		uint32_t latency = micros() - param;
+		total_latency += latency;
+		if(latency > max_latency)
+		{
+			max_latency = latency;
+		}
+
+		++received;
+		break;
+	}
+}
+
+/**
+* Always has a message to process, each one takes BUSY_TIME microseconds
+*/
+void busy_thread(esr::message msg, esr::message_param param)
+{
+	switch (msg)
+	{
+	case MSG_PING:
+		uint32_t start = micros();
+		while(micros() - start < BUSY_TIME)
+		{
+		}
+
+		esr::post_message(esr::THREAD_CURRENT, MSG_PING);
+		break;
+	}
+}
+
+/**
+* Output stream that only counts bytes written
+*/
+class counting_print : public Print
+{
+public:
+	uint32_t count;
+
+	counting_print() : count(0)
+	{
+	}
+
+	using Print::write;
+
+	size_t write(uint8_t c)
+	{
+		++count;
+		return 1;
+	}
+
+	int availableForWrite()
+	{
+		return 0x7FFF;
+	}
+};
+
+/**
+* A thread of the static kernel
+*/
+struct static_sink : esr::static_thread<1>
+{
+	static void thread_func(esr::message msg, esr::message_param param)
+	{
+		++received;
+		checksum += param;
+	}
+};
+
+typedef esr::static_kernel<static_sink, static_sink, static_sink, static_sink, static_sink> static_kernel;
+
+/**
+* Prints benchmark result
+* @param name benchmark name
+* @param count amount of operations performed
+* @param elapsed elapsed time in microseconds
+*/
+void report(const __FlashStringHelper* name, uint32_t count, uint32_t elapsed)
+{
+	uint32_t ns_per_op = static_cast<uint32_t>((static_cast<float>(elapsed) * 1000.0) / count);
+	esr::log(esr::LOG_INFO, F("%ps: %ul ops in %ul us, %ul ns/op"), name, &count, &elapsed, &ns_per_op);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	// Benchmarks don't leave the scheduler idle for deferred work, print results right away
+	esr::log_flush();
+#endif
+}
+
+/**
+* Prints amount of received messages and their checksum
+* @param name benchmark name
+*/
+void report_received(const __FlashStringHelper* name)
+{
+	esr::log(esr::LOG_INFO, F("%ps: received %ul, checksum %ul"), name, &received, &checksum);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+}
+
+/**
+* Posts messages in bursts that fill the whole mailbox and drains them with run_cycle()
+*/
+void bench_mailbox_burst()
+{
+	received = 0;
+	uint32_t posted = 0;
+
+	uint32_t start = micros();
+	while(posted < MESSAGE_COUNT)
+	{
+		// Fill the mailbox up
+		while(esr::post_message(sink_thread_id, MSG_PING) == esr::E_OK)
+		{
+			++posted;
+		}
+
+		// Drain it
+		while(received < posted)
+		{
+			esr::run_cycle();
+		}
+	}
+	uint32_t elapsed = micros() - start;
+
+	report(F("mailbox burst"), posted, elapsed);
+}
+
+/**
+* Posts a single message and drains it right away
+*/
+void bench_mailbox_single()
+{
+	received = 0;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < MESSAGE_COUNT; ++i)
+	{
+		esr::post_message(sink_thread_id, MSG_PING);
+		esr::run_cycle();
+	}
+	uint32_t elapsed = micros() - start;
+
+	report(F("mailbox single"), received, elapsed);
+}
+
+/**
+* Runs dynamic kernel's scheduler loop with a message for each thread
+*/
+void bench_kernel_dynamic()
+{
+	esr::thread_id ids[KERNEL_THREADS];
+	for(uint8_t i = 0; i < KERNEL_THREADS; ++i)
+	{
+		esr::begin_thread(sink_thread, ids[i]);
+		esr::set_thread_flag(ids[i], esr::THREAD_IDLE_LOOP, false);
+		esr::set_thread_queue_size(ids[i], 1);
+	}
+
+	received = 0;
+	checksum = 0;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < CYCLE_COUNT; ++i)
+	{
+		for(uint8_t j = 0; j < KERNEL_THREADS; ++j)
+		{
+			esr::post_message(ids[j], MSG_PING, i + j);
+		}
+
+		esr::run_cycle();
+	}
+	uint32_t elapsed = micros() - start;
+
+	for(uint8_t i = 0; i < KERNEL_THREADS; ++i)
+	{
+		esr::kill_thread(ids[i]);
+	}
+
+	report(F("dynamic kernel run_cycle"), CYCLE_COUNT, elapsed);
+	report_received(F("dynamic kernel run_cycle"));
+}
+
+/**
+* Runs static kernel's scheduler loop with a message for each thread
+*/
+void bench_kernel_static()
+{
+	received = 0;
+	checksum = 0;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < CYCLE_COUNT; ++i)
+	{
+		for(uint8_t j = 0; j < KERNEL_THREADS; ++j)
+		{
+			static_kernel::post_message(j, MSG_PING, i + j);
+		}
+
+		static_kernel::run_cycle();
+	}
+	uint32_t elapsed = micros() - start;
+
+	report(F("static kernel run_cycle"), CYCLE_COUNT, elapsed);
+	report_received(F("static kernel run_cycle"));
+}
+
+/**
+* Posts message bursts to a thread that competes with busy threads and measures queueing delay of the messages
+* @param name benchmark name
+* @param limit drain limit of the receiving thread
+*/
+void bench_drain(const __FlashStringHelper* name, uint8_t limit)
+{
+	esr::thread_id receiver;
+	esr::begin_thread(latency_thread, receiver);
+	esr::set_thread_flag(receiver, esr::THREAD_IDLE_LOOP, false);
+	esr::set_thread_queue_size(receiver, BURST_SIZE);
+	esr::set_thread_drain(receiver, limit);
+
+	esr::thread_id ids[KERNEL_THREADS - 1];
+	for(uint8_t i = 0; i < KERNEL_THREADS - 1; ++i)
+	{
+		esr::begin_thread(busy_thread, ids[i]);
+		esr::set_thread_flag(ids[i], esr::THREAD_IDLE_LOOP, false);
+		esr::set_thread_queue_size(ids[i], 1);
+		esr::post_message(ids[i], MSG_PING);
+	}
+
+	received = 0;
+	total_latency = 0;
+	max_latency = 0;
+
+	for(uint32_t i = 0; i < BURST_COUNT; ++i)
+	{
+		for(uint8_t j = 0; j < BURST_SIZE; ++j)
+		{
+			esr::post_message(receiver, MSG_PING, micros());
+		}
+
+		while(received < (i + 1) * BURST_SIZE)
+		{
+			esr::run_cycle();
+		}
+	}
+
+	for(uint8_t i = 0; i < KERNEL_THREADS - 1; ++i)
+	{
+		esr::kill_thread(ids[i]);
+	}
+
+	esr::kill_thread(receiver);
+
+	uint32_t average = total_latency / received;
+	esr::log(esr::LOG_INFO, F("%ps: %ul messages, latency avg %ul us, max %ul us"), name, &received, &average, &max_latency);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+}
+
+/**
+* Writes a typical sensor log message (text or binary, see __ESR_ENABLE_BINARY_LOGGING) into a byte counter. 
+* With __ESR_ENABLE_LOG_BUFFER each message is flushed, so the time includes copying through the buffer
+*/
+void bench_log()
+{
+	counting_print sink;
+	esr::log_init(sink, esr::LOG_INFO);
+
+	float t = 23.4;
+	float h = 45.6;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < LOG_COUNT; ++i)
+	{
+		esr::log(esr::LOG_INFO, F("INTSNSR\tt = %f deg C, h = %f%%"), &t, &h);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+		esr::log_flush();
+#endif
+	}
+	uint32_t elapsed = micros() - start;
+
+	esr::log_init(Serial, esr::LOG_INFO);
+
+	uint32_t bytes = sink.count / LOG_COUNT;
+	report(F("log"), LOG_COUNT, elapsed);
+	esr::log(esr::LOG_INFO, F("log: %ul bytes/message"), &bytes);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+}
+
+/**
+* Reference digit extraction (as in gui.cpp before esr_format): a division and a modulo by powers of ten per digit
+*/
+uint16_t reference_power_of_10(uint8_t p)
+{
+	uint16_t r = 1;
+	for(uint8_t i = 0; i < p; ++i)
+	{
+		r *= 10;
+	}
+	return r;
+}
+
+char reference_get_digit(uint16_t value, uint8_t index)
+{
+	uint8_t d = static_cast<uint8_t>(value % reference_power_of_10(index + 1) / reference_power_of_10(index));
+	return d + '0';
+}
+
+/**
+* Reference "+ddd.d" formatting
+*/
+void reference_print_float(float f, char* buffer)
+{
+	uint16_t value = static_cast<uint16_t>(abs(f * 10.0));
+
+	buffer[0] = f >= 0 ? '+' : '-';
+	buffer[1] = reference_get_digit(value, 3);
+	buffer[2] = reference_get_digit(value, 2);
+	buffer[3] = reference_get_digit(value, 1);
+	buffer[4] = '.';
+	buffer[5] = reference_get_digit(value, 0);
+	buffer[6] = 0;
+}
+
+/**
+* Formats sensor-like values (-40.0..79.9) as "+ddd.d": the reference routine, esr::format_float(), 
+* esr::format_fixed() of a value already in tenths and Print::print(float)
+*/
+void bench_format()
+{
+	char buffer[esr::FLOAT_BUFFER_SIZE];
+	uint32_t checksum = 0;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < FORMAT_COUNT; ++i)
+	{
+		reference_print_float(static_cast<int16_t>(i % 1200 - 400) * 0.1f, buffer);
+		checksum += buffer[3];
+	}
+	uint32_t elapsed = micros() - start;
+	report(F("format reference"), FORMAT_COUNT, elapsed);
+
+	start = micros();
+	for(uint32_t i = 0; i < FORMAT_COUNT; ++i)
+	{
+		esr::format_float(buffer, static_cast<int16_t>(i % 1200 - 400) * 0.1f, 1, 6, esr::NUMBER_PLUS | esr::NUMBER_ZERO_PAD);
+		checksum += buffer[3];
+	}
+	elapsed = micros() - start;
+	report(F("format_float"), FORMAT_COUNT, elapsed);
+
+	start = micros();
+	for(uint32_t i = 0; i < FORMAT_COUNT; ++i)
+	{
+		esr::format_fixed(buffer, static_cast<int16_t>(i % 1200 - 400), 1, 6, esr::NUMBER_PLUS | esr::NUMBER_ZERO_PAD);
+		checksum += buffer[3];
+	}
+	elapsed = micros() - start;
+	report(F("format_fixed"), FORMAT_COUNT, elapsed);
+
+	counting_print sink;
+	start = micros();
+	for(uint32_t i = 0; i < FORMAT_COUNT; ++i)
+	{
+		sink.print(static_cast<int16_t>(i % 1200 - 400) * 0.1f, 1);
+	}
+	elapsed = micros() - start;
+	checksum += sink.count;
+	report(F("Print::print(float)"), FORMAT_COUNT, elapsed);
+
+	esr::log(esr::LOG_INFO, F("format checksum %ul"), &checksum);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+}
+
+/**
+* Arms and disarms thread timers with different periods (timer heap updates)
+*/
+void bench_timer_arm()
+{
+	esr::thread_id ids[KERNEL_THREADS];
+	for(uint8_t i = 0; i < KERNEL_THREADS; ++i)
+	{
+		esr::begin_thread(sink_thread, ids[i]);
+		esr::set_thread_flag(ids[i], esr::THREAD_IDLE_LOOP, false);
+		esr::set_thread_queue_size(ids[i], 1);
+	}
+
+	uint32_t count = 0;
+
+	uint32_t start = micros();
+	for(uint32_t i = 0; i < CYCLE_COUNT; ++i)
+	{
+		for(uint8_t j = 0; j < KERNEL_THREADS; ++j)
+		{
+			esr::set_timer_ms(ids[j], 1000 + ((i + j * 7) & 0xFF));
+			++count;
+		}
+
+		for(uint8_t j = 0; j < KERNEL_THREADS; ++j)
+		{
+			esr::clear_timer(ids[j]);
+		}
+	}
+	uint32_t elapsed = micros() - start;
+
+	for(uint8_t i = 0; i < KERNEL_THREADS; ++i)
+	{
+		esr::kill_thread(ids[i]);
+	}
+
+	report(F("timer arm/clear"), count, elapsed);
+}
+
+void setup()
+{
+	Serial.begin(57600);
+	esr::log_init(Serial, esr::LOG_INFO);
+
+	esr::log_memory_usage();
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	esr::log_flush();
+#endif
+
+	esr::begin_thread(sink_thread, sink_thread_id);
+	esr::set_thread_flag(sink_thread_id, esr::THREAD_IDLE_LOOP, false);
+
+	bench_mailbox_single();
+	bench_mailbox_burst();
+	bench_kernel_dynamic();
+	bench_kernel_static();
+	bench_timer_arm();
+	bench_log();
+	bench_format();
+	bench_drain(F("drain 1"), 1);
+	bench_drain(F("drain 2"), 2);
+	bench_drain(F("drain all"), esr::DRAIN_ALL);
+}
+
+void loop()
+{
+}
@@ -7,7 +7,7 @@ bool is_on;
 uint32_t interval = 500;
 esr::thread_id ctrl_thread_id, led_thread_id, uart_thread_id;
 
-void led_thread(esr::message msg)
+void led_thread(esr::message msg, esr::message_param param)
 {
 	switch (msg)
 	{
@@ -21,7 +21,7 @@ void led_thread(esr::message msg)
 	}
 }
 
-void ctrl_thread(esr::message msg)
+void ctrl_thread(esr::message msg, esr::message_param param)
 {
 	switch (msg)
 	{
@@ -53,7 +53,7 @@ void ctrl_thread(esr::message msg)
 	}
 }
 
-void uart_thread(esr::message msg)
+void uart_thread(esr::message msg, esr::message_param param)
 {
 	switch (msg)
 	{
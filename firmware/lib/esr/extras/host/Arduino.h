@@ -0,0 +1,140 @@
+#ifndef _ESR_HOST_ARDUINO_h
+#define _ESR_HOST_ARDUINO_h
+
+/*
+* Host (Linux) Arduino shim:
+* ==========================
+* A minimal subset of Arduino API required to build esr library on a PC.
+* Time is virtual: millis() and micros() are driven by host::set_time_us() and host::advance_us().
+* If ESR_HOST_REAL_TIME is defined then they return monotonic clock time instead (for benchmarks).
+* See host.cpp for build instructions.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+/**
+* Marks host build of esr library
+*/
+#define __ESR_HOST
+
+#define PROGMEM
+#define DEC 10
+#define HEX 16
+#define HIGH 1
+#define LOW 0
+
+class __FlashStringHelper;
+
+/**
+* Flash strings are plain strings on host
+*/
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+#define pgm_read_dword(address) (*reinterpret_cast<const uint32_t*>(address))
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+namespace host
+{
+	/**
+	* Sets virtual time
+	* @param time time in microseconds
+	*/
+	void set_time_us(uint64_t time);
+
+	/**
+	* Moves virtual time forward
+	* @param time time span in microseconds
+	*/
+	void advance_us(uint64_t time);
+
+	/**
+	* Gets virtual time
+	* @return time in microseconds
+	*/
+	uint64_t time_us();
+
+	/**
+	* Moves virtual time forward to the beginning of the specified millisecond.
+	* This is what esr::run_cycle() does instead of sleeping when no thread is ready.
+	* Has no effect if the time has already come or real time is used
+	* @param time time in milliseconds (in terms of millis())
+	*/
+	void sleep_until_ms(uint32_t time);
+}
+
+/**
+* Base class of text output streams
+*/
+class Print
+{
+public:
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+
+	/**
+	* Gets amount of bytes that can be written without waiting, 0 if unknown (as in Arduino core)
+	*/
+	virtual int availableForWrite() { return 0; }
+
+	size_t print(char c);
+	size_t print(const char* s);
+	size_t print(const __FlashStringHelper* s);
+	size_t print(int value, int base = DEC);
+	size_t print(unsigned int value, int base = DEC);
+	size_t print(unsigned char value, int base = DEC);
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t print(double value, int digits = 2);
+	size_t println();
+	size_t println(const char* s);
+	size_t println(const __FlashStringHelper* s);
+};
+
+/**
+* Output stream that collects text in memory
+*/
+class string_print : public Print
+{
+public:
+	std::string text;
+
+	using Print::write;
+
+	size_t write(uint8_t c)
+	{
+		text += static_cast<char>(c);
+		return 1;
+	}
+
+	int availableForWrite() { return 0x7FFF; }
+};
+
+/**
+* Serial port, writes to stdout
+*/
+class host_serial : public Print
+{
+public:
+	void begin(unsigned long baud) { (void)baud; }
+
+	using Print::write;
+	size_t write(uint8_t c);
+
+	// stdout never makes the caller wait for long
+	int availableForWrite() { return 0x7FFF; }
+};
+
+extern host_serial Serial;
+
+#endif
@@ -0,0 +1,191 @@
+/*
+* Host (Linux) build of esr library:
+* ==================================
+* Build a sketch together with esr library and this shim (from firmware/lib/esr), 
+* ex. the benchmark (make benchmark from extras/host does the same):
+*
+*	g++ -O2 -DARDUINO=100 -I extras/host -I . -include Arduino.h \
+*		-x c++ examples/benchmark/benchmark.ino -x none \
+*		esr_kernel.cpp esr_io.cpp esr_errors.cpp esr_format.cpp esr_watchdog.cpp extras/host/host.cpp extras/host/host_main.cpp \
+*		-DESR_HOST_REAL_TIME -o benchmark
+*
+* host_main.cpp runs setup() and then loop() the amount of times given as the first command line argument.
+* Omit host_main.cpp to provide your own main() (ex. scenarios driven by host::advance_us()).
+* Drop ESR_HOST_REAL_TIME to run on virtual time.
+*
+* Unit tests (extras/host/tests) run on virtual time: make test (from extras/host)
+*/
+
+#include "Arduino.h"
+#include <stdio.h>
+
+#ifdef ESR_HOST_REAL_TIME
+#include <time.h>
+#endif
+
+host_serial Serial;
+
+uint64_t _time_us;
+
+#ifdef ESR_HOST_REAL_TIME
+
+uint64_t host::time_us()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return static_cast<uint64_t>(t.tv_sec) * 1000000 + t.tv_nsec / 1000;
+}
+
+void host::set_time_us(uint64_t time)
+{
+	(void)time;
+}
+
+void host::advance_us(uint64_t time)
+{
+	(void)time;
+}
+
+void host::sleep_until_ms(uint32_t time)
+{
+	(void)time;
+}
+
+#else
+
+uint64_t host::time_us()
+{
+	return _time_us;
+}
+
+void host::set_time_us(uint64_t time)
+{
+	_time_us = time;
+}
+
+void host::advance_us(uint64_t time)
+{
+	_time_us += time;
+}
+
+void host::sleep_until_ms(uint32_t time)
+{
+	// Compare with respect to millis() overflow
+	int32_t delta = static_cast<int32_t>(time - millis());
+	if(delta > 0)
+	{
+		_time_us = (_time_us / 1000 + delta) * 1000;
+	}
+}
+
+#endif
+
+uint32_t millis()
+{
+	return static_cast<uint32_t>(host::time_us() / 1000);
+}
+
+uint32_t micros()
+{
+	return static_cast<uint32_t>(host::time_us());
+}
+
+void delay(uint32_t ms)
+{
+	host::advance_us(static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+	host::advance_us(us);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	for(size_t i = 0; i < size; ++i)
+	{
+		n += write(buffer[i]);
+	}
+
+	return n;
+}
+
+size_t Print::print(char c)
+{
+	return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(const char* s)
+{
+	size_t n = 0;
+	while(*s != '\0')
+	{
+		n += write(static_cast<uint8_t>(*s));
+		++s;
+	}
+
+	return n;
+}
+
+size_t Print::print(const __FlashStringHelper* s)
+{
+	return print(reinterpret_cast<const char*>(s));
+}
+
+size_t Print::print(int value, int base)
+{
+	return print(static_cast<long>(value), base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+	return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+	return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(long value, int base)
+{
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", value);
+	return print(buffer);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", value);
+	return print(buffer);
+}
+
+size_t Print::print(double value, int digits)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+	return print(buffer);
+}
+
+size_t Print::println()
+{
+	return print("\r\n");
+}
+
+size_t Print::println(const char* s)
+{
+	return print(s) + println();
+}
+
+size_t Print::println(const __FlashStringHelper* s)
+{
+	return print(s) + println();
+}
+
+size_t host_serial::write(uint8_t c)
+{
+	putchar(c);
+	return 1;
+}
@@ -0,0 +1,22 @@
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+/**
+* Runs a sketch: setup() and then loop() as many times as specified by the first argument (0 by default)
+*/
+int main(int argc, char** argv)
+{
+	unsigned long loops = argc > 1
+		? strtoul(argv[1], NULL, 10)
+		: 0;
+
+	setup();
+	for(unsigned long i = 0; i < loops; ++i)
+	{
+		loop();
+	}
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include "esr_test.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace esr_test;
+
+/**
+* Registered tests, in reverse order of registration
+*/
+test_case* _tests = NULL;
+
+/**
+* Amount of failed checks of the current test
+*/
+int _failures = 0;
+
+bool esr_test::register_test(test_case& test)
+{
+	test.next = _tests;
+	_tests = &test;
+	return true;
+}
+
+void esr_test::fail(const char* file, int line, const std::string& message)
+{
+	fprintf(stderr, "%s:%d: failure: %s\n", file, line, message.c_str());
+	++_failures;
+}
+
+void esr_test::stop()
+{
+	fflush(stderr);
+	_exit(1);
+}
+
+/**
+* Runs a test in a child process, so the test gets a fresh kernel
+* @param test test
+* @return true if the test has passed
+*/
+bool run_test(const test_case& test)
+{
+	fflush(stdout);
+	fflush(stderr);
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		test.func();
+		fflush(stdout);
+		fflush(stderr);
+		_exit(_failures == 0 ? 0 : 1);
+	}
+
+	int status = 0;
+	if(pid < 0 || waitpid(pid, &status, 0) != pid)
+	{
+		return false;
+	}
+
+	if(WIFSIGNALED(status))
+	{
+		fprintf(stderr, "terminated by signal %d\n", WTERMSIG(status));
+		return false;
+	}
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+* Runs all tests or ones which full names (suite.name) contain the first command line argument
+*/
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1
+		? argv[1]
+		: "";
+
+	// Restore the order of registration
+	test_case* tests = NULL;
+	while(_tests != NULL)
+	{
+		test_case* test = _tests;
+		_tests = test->next;
+		test->next = tests;
+		tests = test;
+	}
+
+	int passed = 0;
+	int failed = 0;
+	for(test_case* test = tests; test != NULL; test = test->next)
+	{
+		std::string name = std::string(test->suite) + "." + test->name;
+		if(name.find(filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		printf("[ RUN      ] %s\n", name.c_str());
+		if(run_test(*test))
+		{
+			printf("[       OK ] %s\n", name.c_str());
+			++passed;
+		}
+		else
+		{
+			printf("[  FAILED  ] %s\n", name.c_str());
+			++failed;
+		}
+	}
+
+	printf("[==========] %d passed, %d failed\n", passed, failed);
+	return failed == 0 ? 0 : 1;
+}
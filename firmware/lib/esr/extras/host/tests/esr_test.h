@@ -0,0 +1,159 @@
+#ifndef _ESR_TEST_h
+#define _ESR_TEST_h
+
+#include "Arduino.h"
+#include <sstream>
+#include <string>
+
+/*
+* Host tests:
+* ===========
+* A minimal subset of googletest: TEST() defines a test, EXPECT_*() report a failure and go on,
+* ASSERT_*() report a failure and stop the test. Each test runs in its own process (fork()),
+* so every test starts with a fresh kernel state and virtual time at zero.
+*
+*	TEST(mailbox, full)
+*	{
+*		...
+*		ASSERT_EQ(esr::E_OK, esr::begin_thread(thread_func, id));
+*		EXPECT_EQ(esr::E_MESSAGE_QUEUE_IS_FULL, esr::post_message(id, MSG_TEST));
+*	}
+*
+* Build and run all tests (from extras/host): make test
+* Run tests which names contain a string: ./esr_tests timers
+*/
+
+namespace esr_test
+{
+	/**
+	* Test function type
+	*/
+	typedef void (*test_func)();
+
+	/**
+	* Registered test
+	*/
+	struct test_case
+	{
+		const char* suite;
+		const char* name;
+		test_func func;
+		test_case* next;
+	};
+
+	/**
+	* Adds a test to the list of tests to be run
+	* @param test test
+	* @return true
+	*/
+	bool register_test(test_case& test);
+
+	/**
+	* Reports a failed check
+	* @param file source file
+	* @param line source line
+	* @param message failure description
+	*/
+	void fail(const char* file, int line, const std::string& message);
+
+	/**
+	* Stops the current test after a failed ASSERT_*()
+	*/
+	void stop();
+
+	/**
+	* Writes a value into a failure description, 1-byte integers are written as numbers
+	*/
+	template<typename T> void write_value(std::ostream& out, const T& value)
+	{
+		out << value;
+	}
+
+	inline void write_value(std::ostream& out, const uint8_t& value)
+	{
+		out << static_cast<unsigned int>(value);
+	}
+
+	inline void write_value(std::ostream& out, const int8_t& value)
+	{
+		out << static_cast<int>(value);
+	}
+
+	inline void write_value(std::ostream& out, const std::string& value)
+	{
+		out << '"' << value << '"';
+	}
+
+	/**
+	* Compares two values
+	* @return true if they are equal, a failure is reported otherwise
+	*/
+	template<typename E, typename A> bool check_eq(const char* file, int line,
+		const char* expected_text, const char* actual_text, const E& expected, const A& actual)
+	{
+		if(expected == actual)
+		{
+			return true;
+		}
+
+		std::ostringstream message;
+		message << "expected " << actual_text << " == " << expected_text << ", actual ";
+		write_value(message, actual);
+		message << " vs ";
+		write_value(message, expected);
+		fail(file, line, message.str());
+		return false;
+	}
+
+	/**
+	* Compares two integers, this overload takes constants of unnamed enums (ex. esr::E_OK)
+	* which C++98 doesn't allow as template arguments
+	*/
+	inline bool check_eq(const char* file, int line,
+		const char* expected_text, const char* actual_text, int64_t expected, int64_t actual)
+	{
+		return check_eq<int64_t, int64_t>(file, line, expected_text, actual_text, expected, actual);
+	}
+
+	/**
+	* Checks a condition
+	* @return true if the condition holds, a failure is reported otherwise
+	*/
+	inline bool check_true(const char* file, int line, const char* text, bool value)
+	{
+		if(!value)
+		{
+			fail(file, line, std::string("expected ") + text);
+		}
+
+		return value;
+	}
+}
+
+/**
+* Defines a test
+* @param suite test suite name (identifier)
+* @param name test name (identifier)
+*/
+#define TEST(suite, name) \
+	void suite##_##name(); \
+	esr_test::test_case suite##_##name##_case = { #suite, #name, suite##_##name, NULL }; \
+	bool suite##_##name##_registered = esr_test::register_test(suite##_##name##_case); \
+	void suite##_##name()
+
+#define EXPECT_EQ(expected, actual) \
+	esr_test::check_eq(__FILE__, __LINE__, #expected, #actual, (expected), (actual))
+
+#define EXPECT_TRUE(cond) \
+	esr_test::check_true(__FILE__, __LINE__, #cond, (cond))
+
+#define EXPECT_FALSE(cond) \
+	esr_test::check_true(__FILE__, __LINE__, "!(" #cond ")", !(cond))
+
+#define ASSERT_EQ(expected, actual) \
+	do { if(!EXPECT_EQ(expected, actual)) esr_test::stop(); } while(0)
+
+#define ASSERT_TRUE(cond) \
+	do { if(!EXPECT_TRUE(cond)) esr_test::stop(); } while(0)
+
+#endif
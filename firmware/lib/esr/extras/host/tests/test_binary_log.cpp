@@ -0,0 +1,166 @@
+#include "esr_test.h"
+#include <esr_io.h>
+
+#ifdef __ESR_ENABLE_BINARY_LOGGING
+
+using namespace esr;
+
+/**
+* Decoded binary log frame
+*/
+struct frame
+{
+	uint8_t level;
+	uintptr_t format;
+	uint32_t time;
+	std::string args;
+};
+
+/**
+* Decodes a binary log frame, extras/log/esr_log.py reads the same layout
+* @param text log stream output
+* @param offset [in, out] frame offset, moved past the frame
+* @param result [out] frame
+*/
+static void decode(const std::string& text, size_t& offset, frame& result)
+{
+	const size_t header = 2 + sizeof(uintptr_t) + sizeof(uint32_t);
+	ASSERT_TRUE(text.size() >= offset + header);
+	ASSERT_EQ(0xA5, static_cast<uint8_t>(text[offset]));
+
+	uint8_t size = static_cast<uint8_t>(text[offset + 1]) & 0x3F;
+	result.level = static_cast<uint8_t>(text[offset + 1]) >> 6;
+	memcpy(&result.format, text.data() + offset + 2, sizeof(result.format));
+	memcpy(&result.time, text.data() + offset + 2 + sizeof(uintptr_t), sizeof(result.time));
+
+	ASSERT_TRUE(text.size() >= offset + header + size);
+	result.args = text.substr(offset + header, size);
+	offset += header + size;
+}
+
+/**
+* Writes buffered messages into the log stream
+*/
+static void flush()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	log_flush();
+#endif
+}
+
+/**
+* Reads an argument value from decoded frame arguments
+*/
+template<typename T> T read_arg(const std::string& args, size_t& offset)
+{
+	T value;
+	EXPECT_TRUE(args.size() >= offset + sizeof(T));
+	memcpy(&value, args.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return value;
+}
+
+TEST(binary_log, round_trip)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+	host::set_time_us(1234567);
+
+	const __FlashStringHelper* format = F("%c %s %ps %e %b %ub %xb %d %ud %xd %l %ul %xl %f %%");
+	const __FlashStringHelper* name = F("pgm");
+	int32_t l = -100000;
+	uint32_t ul = 4000000000u;
+	uint32_t xl = 0xDEADBEEF;
+	float f = -1.25f;
+	EXPECT_EQ(E_OK, log(LOG_ERROR, format, 
+		'a', "str", name, E_WRONG_THREAD, 
+		static_cast<int8_t>(-5), static_cast<uint8_t>(200), static_cast<uint8_t>(0xAB), 
+		static_cast<int16_t>(-1000), static_cast<uint16_t>(60000), static_cast<uint16_t>(0xBEEF), 
+		&l, &ul, &xl, &f));
+	flush();
+
+	size_t offset = 0;
+	frame result;
+	decode(out.text, offset, result);
+	EXPECT_EQ(out.text.size(), offset);
+	EXPECT_EQ(static_cast<uint8_t>(LOG_ERROR), result.level);
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(format), result.format);
+	EXPECT_EQ(1234u, result.time);
+
+	size_t arg = 0;
+	EXPECT_EQ('a', read_arg<char>(result.args, arg));
+	EXPECT_EQ(std::string("str"), std::string(result.args.c_str() + arg));
+	arg += 4;
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(name), read_arg<uintptr_t>(result.args, arg));
+	EXPECT_EQ(static_cast<uint8_t>(E_WRONG_THREAD), read_arg<uint8_t>(result.args, arg));
+	EXPECT_EQ(-5, read_arg<int8_t>(result.args, arg));
+	EXPECT_EQ(200, read_arg<uint8_t>(result.args, arg));
+	EXPECT_EQ(0xAB, read_arg<uint8_t>(result.args, arg));
+	EXPECT_EQ(-1000, read_arg<int16_t>(result.args, arg));
+	EXPECT_EQ(60000, read_arg<uint16_t>(result.args, arg));
+	EXPECT_EQ(0xBEEF, read_arg<uint16_t>(result.args, arg));
+	EXPECT_EQ(l, read_arg<int32_t>(result.args, arg));
+	EXPECT_EQ(ul, read_arg<uint32_t>(result.args, arg));
+	EXPECT_EQ(xl, read_arg<uint32_t>(result.args, arg));
+	EXPECT_EQ(f, read_arg<float>(result.args, arg));
+	EXPECT_EQ(result.args.size(), arg);
+}
+
+TEST(binary_log, frames_in_order)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	const __FlashStringHelper* format = F("message %ud");
+	for(uint16_t i = 0; i < 10; ++i)
+	{
+		host::set_time_us(i * 1000);
+		EXPECT_EQ(E_OK, log(LOG_INFO, format, i));
+	}
+	flush();
+
+	size_t offset = 0;
+	for(uint16_t i = 0; i < 10; ++i)
+	{
+		frame result;
+		decode(out.text, offset, result);
+		EXPECT_EQ(static_cast<uint8_t>(LOG_INFO), result.level);
+		EXPECT_EQ(static_cast<uint32_t>(i), result.time);
+
+		size_t arg = 0;
+		EXPECT_EQ(i, read_arg<uint16_t>(result.args, arg));
+	}
+
+	EXPECT_EQ(out.text.size(), offset);
+}
+
+TEST(binary_log, long_string)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	// Strings are cut to fit into a frame
+	std::string s(100, 'x');
+	EXPECT_EQ(E_OK, log(LOG_INFO, F("%s"), s.c_str()));
+	flush();
+
+	size_t offset = 0;
+	frame result;
+	decode(out.text, offset, result);
+	EXPECT_EQ(63u, result.args.size());
+	EXPECT_EQ(std::string(62, 'x'), std::string(result.args.c_str()));
+}
+
+TEST(binary_log, text_messages)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	// RAM format strings are written as text, unknown placeholders fail as in text logs
+	EXPECT_EQ(E_OK, log(LOG_INFO, "ram %ub", static_cast<uint8_t>(7)));
+	EXPECT_EQ(E_INCORRECT_FORMAT, log(LOG_INFO, F("value %q"), 1));
+	flush();
+	EXPECT_EQ(std::string("INFRM\tram 7\r\n"), out.text);
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "esr_test.h"
+#include <esr_kernel.h>
+
+using namespace esr;
+
+const message MSG_TEST = MSG_USER + 1;
+
+static uint16_t _received;
+
+/**
+* Amount of messages the thread posts to itself, and virtual time each message takes, in microseconds
+*/
+static uint16_t _repost;
+static uint32_t _message_time;
+
+static void drain_thread(message msg, message_param param)
+{
+	if(msg != MSG_TEST)
+	{
+		return;
+	}
+
+	++_received;
+	host::advance_us(_message_time);
+	if(_repost > 0)
+	{
+		--_repost;
+		post_message(THREAD_CURRENT, MSG_TEST);
+	}
+}
+
+/**
+* Starts a thread and posts messages to it
+* @param limit drain limit
+* @param messages amount of messages
+*/
+static thread_id start_thread(uint8_t limit, uint8_t messages = MAX_THREAD_QUEUE)
+{
+	thread_id id = 0;
+	ASSERT_EQ(E_OK, begin_thread(drain_thread, id));
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, false));
+	ASSERT_EQ(E_OK, set_thread_drain(id, limit));
+	for(uint8_t i = 0; i < messages; ++i)
+	{
+		ASSERT_EQ(E_OK, post_message(id, MSG_TEST));
+	}
+
+	return id;
+}
+
+TEST(drain, one_per_iteration)
+{
+	start_thread(1);
+	run_cycle();
+	EXPECT_EQ(1u, _received);
+	run_cycle();
+	EXPECT_EQ(2u, _received);
+}
+
+TEST(drain, limit)
+{
+	start_thread(2);
+	run_cycle();
+	EXPECT_EQ(2u, _received);
+	run_cycle();
+	EXPECT_EQ(MAX_THREAD_QUEUE < 4 ? MAX_THREAD_QUEUE : 4u, _received);
+}
+
+TEST(drain, all)
+{
+	start_thread(DRAIN_ALL);
+	run_cycle();
+	EXPECT_EQ(static_cast<uint16_t>(MAX_THREAD_QUEUE), _received);
+}
+
+TEST(drain, all_beyond_counter_range)
+{
+	// Virtual time stands still, so the budget is never spent and the queue never gets empty
+	_repost = 300;
+	start_thread(DRAIN_ALL, 1);
+	run_cycle();
+	EXPECT_EQ(301u, _received);
+}
+
+TEST(drain, budget)
+{
+	// Every message takes 1/4 of the budget, draining stops once the budget is spent
+	_repost = 100;
+	_message_time = __ESR_DRAIN_BUDGET / 4;
+	start_thread(DRAIN_ALL, 1);
+	run_cycle();
+
+	// The budget starts after the first message
+	EXPECT_EQ(5u, _received);
+
+	run_cycle();
+	EXPECT_EQ(10u, _received);
+}
+
+TEST(drain, other_threads_served)
+{
+	_repost = 100;
+	_message_time = __ESR_DRAIN_BUDGET / 4;
+	start_thread(DRAIN_ALL, 1);
+	start_thread(1, 1);
+
+	// A thread that doesn't drain gets its message within the same iteration
+	run_cycle();
+	EXPECT_EQ(6u, _received);
+}
+
+TEST(drain, wrong_thread)
+{
+	thread_id id = start_thread(1);
+	EXPECT_EQ(E_WRONG_THREAD, set_thread_drain(MAX_THREADS, 1));
+	EXPECT_EQ(E_WRONG_THREAD, set_thread_drain(id + 1, 1));
+
+	ASSERT_EQ(E_OK, kill_thread(id));
+	EXPECT_EQ(E_WRONG_THREAD, set_thread_drain(id, DRAIN_ALL));
+}
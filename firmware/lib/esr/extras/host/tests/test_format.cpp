@@ -0,0 +1,175 @@
+#include "esr_test.h"
+#include <esr_format.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace esr;
+
+/**
+* Output of a formatting call: the text and its length returned by the call
+*/
+static char _buffer[32];
+
+static std::string text(uint8_t length)
+{
+	EXPECT_EQ(strlen(_buffer), static_cast<size_t>(length));
+	return _buffer;
+}
+
+TEST(format, uint)
+{
+	EXPECT_EQ(std::string("0"), text(format_uint(_buffer, 0)));
+	EXPECT_EQ(std::string("65535"), text(format_uint(_buffer, 65535)));
+	EXPECT_EQ(std::string("65536"), text(format_uint(_buffer, 65536)));
+	EXPECT_EQ(std::string("4294967295"), text(format_uint(_buffer, 4294967295u)));
+	EXPECT_EQ(std::string("  42"), text(format_uint(_buffer, 42, 4)));
+	EXPECT_EQ(std::string("0042"), text(format_uint(_buffer, 42, 4, NUMBER_ZERO_PAD)));
+}
+
+TEST(format, int)
+{
+	EXPECT_EQ(std::string("-2147483648"), text(format_int(_buffer, -2147483647 - 1)));
+	EXPECT_EQ(std::string("  -5"), text(format_int(_buffer, -5, 4)));
+	EXPECT_EQ(std::string("+ 23"), text(format_int(_buffer, 23, 4, NUMBER_PLUS | NUMBER_SIGN_FIRST)));
+	EXPECT_EQ(std::string("-  5"), text(format_int(_buffer, -5, 4, NUMBER_PLUS | NUMBER_SIGN_FIRST)));
+}
+
+TEST(format, fixed)
+{
+	EXPECT_EQ(std::string("-23.5"), text(format_fixed(_buffer, -235, 1)));
+	EXPECT_EQ(std::string("+023.5"), text(format_fixed(_buffer, 235, 1, 6, NUMBER_PLUS | NUMBER_ZERO_PAD)));
+	EXPECT_EQ(std::string("0.005"), text(format_fixed(_buffer, 5, 3)));
+	EXPECT_EQ(std::string("0.123456789"), text(format_fixed(_buffer, 123456789, 9)));
+	EXPECT_EQ(std::string("1.234567890"), text(format_fixed(_buffer, 1234567890, 9)));
+}
+
+TEST(format, float)
+{
+	EXPECT_EQ(std::string("23.5"), text(format_float(_buffer, 23.45f, 1)));
+	EXPECT_EQ(std::string("23.4"), text(format_float(_buffer, 23.4f, 1)));
+	EXPECT_EQ(std::string("0.05"), text(format_float(_buffer, 0.05f, 2)));
+	EXPECT_EQ(std::string("-1"), text(format_float(_buffer, -0.5f, 0)));
+	EXPECT_EQ(std::string("-0.1"), text(format_float(_buffer, -0.06f, 1)));
+
+	// Values rounded to zero lose their sign
+	EXPECT_EQ(std::string("0.0"), text(format_float(_buffer, -0.001f, 1)));
+	EXPECT_EQ(std::string("+000.0"), text(format_float(_buffer, -0.001f, 1, 6, NUMBER_PLUS | NUMBER_ZERO_PAD)));
+}
+
+TEST(format, float_special)
+{
+	EXPECT_EQ(std::string("nan"), text(format_float(_buffer, NAN, 2)));
+	EXPECT_EQ(std::string("inf"), text(format_float(_buffer, INFINITY, 2)));
+	EXPECT_EQ(std::string("inf"), text(format_float(_buffer, -INFINITY, 2)));
+	EXPECT_EQ(std::string("ovf"), text(format_float(_buffer, 5e9f, 0)));
+	EXPECT_EQ(std::string("ovf"), text(format_float(_buffer, -5e9f, 2)));
+
+	// Special values are padded with spaces to the field width, never with zeroes
+	EXPECT_EQ(std::string("   nan"), text(format_float(_buffer, NAN, 1, 6, NUMBER_PLUS | NUMBER_ZERO_PAD)));
+	EXPECT_EQ(std::string("  inf"), text(format_float(_buffer, -INFINITY, 1, 5, NUMBER_ZERO_PAD)));
+}
+
+/**
+* Print::print(float) of Arduino AVR core: the integer part and the decimals one by one
+*/
+static std::string arduino_print_float(double number, uint8_t digits)
+{
+	if(isnan(number)) return "nan";
+	if(isinf(number)) return "inf";
+	if(number > 4294967040.0 || number < -4294967040.0) return "ovf";
+
+	std::string result;
+	if(number < 0.0)
+	{
+		result += '-';
+		number = -number;
+	}
+
+	double rounding = 0.5;
+	for(uint8_t i = 0; i < digits; ++i)
+	{
+		rounding /= 10.0;
+	}
+
+	number += rounding;
+	unsigned long int_part = static_cast<unsigned long>(number);
+	double remainder = number - static_cast<double>(int_part);
+
+	char text[16];
+	snprintf(text, sizeof(text), "%lu", int_part);
+	result += text;
+	if(digits > 0)
+	{
+		result += '.';
+	}
+
+	while(digits-- > 0)
+	{
+		remainder *= 10.0;
+		unsigned int digit = static_cast<unsigned int>(remainder);
+		result += static_cast<char>('0' + digit);
+		remainder -= digit;
+	}
+
+	return result;
+}
+
+TEST(format, float_beyond_32_bits)
+{
+	// Scaled values beyond 32 bits are written as numbers up to 4294967040, as Print does. 
+	// Scaled values beyond 2^23 aren't exact floats, their decimals don't pick up float errors
+	EXPECT_EQ(std::string("-90985.500"), text(format_float(_buffer, -90985.5f, 3)));
+	EXPECT_EQ(std::string("146218.75"), text(format_float(_buffer, 146218.75f, 2)));
+	EXPECT_EQ(std::string("50000000.00"), text(format_float(_buffer, 5e7f, 2)));
+	EXPECT_EQ(std::string("-4294967040.00"), text(format_float(_buffer, -4294967040.0f, 2)));
+	EXPECT_EQ(std::string("123.000000000"), text(format_float(_buffer, 123.0f, 9)));
+	EXPECT_EQ(std::string("+04294967040.000000000"), 
+		text(format_float(_buffer, 4294967040.0f, 9, 22, NUMBER_PLUS | NUMBER_ZERO_PAD)));
+
+	// Values exact in floats and without rounding ties: Print adds the rounding in float arithmetic, 
+	// so it writes ties either way (ex. 177879.75 as "177879.7")
+	srand(1);
+	for(uint32_t i = 0; i < 100000; ++i)
+	{
+		const int32_t n = rand() % 2000001 - 1000000;
+		const bool quarters = rand() % 2 != 0;
+		const float value = static_cast<float>(n) * (quarters ? 0.25f : 4096.0f);
+		const uint8_t decimals = quarters ? 2 + rand() % 3 : rand() % 4;
+		format_float(_buffer, value, decimals);
+		ASSERT_EQ(arduino_print_float(value, decimals), std::string(_buffer));
+	}
+}
+
+TEST(format, round_trip)
+{
+	// Formatted values parse back to the original ones and match printf() output
+	srand(1);
+	char expected[32];
+	for(uint32_t i = 0; i < 100000; ++i)
+	{
+		uint32_t value = (static_cast<uint32_t>(rand()) * 2654435761u ^ rand()) >> (rand() % 32);
+		format_uint(_buffer, value);
+		snprintf(expected, sizeof(expected), "%u", value);
+		ASSERT_EQ(std::string(expected), std::string(_buffer));
+		ASSERT_EQ(value, static_cast<uint32_t>(strtoul(_buffer, NULL, 10)));
+
+		int32_t signed_value = static_cast<int32_t>(value) * (rand() & 1 ? 1 : -1);
+		format_int(_buffer, signed_value);
+		ASSERT_EQ(signed_value, static_cast<int32_t>(strtol(_buffer, NULL, 10)));
+
+		uint8_t decimals = rand() % 5;
+		uint8_t width = rand() % 14;
+		format_fixed(_buffer, signed_value, decimals, width, NUMBER_ZERO_PAD);
+
+		double scaled = signed_value;
+		for(uint8_t j = 0; j < decimals; ++j)
+		{
+			scaled /= 10;
+		}
+
+		snprintf(expected, sizeof(expected), "%0*.*f", width, decimals, scaled);
+		ASSERT_EQ(std::string(expected), std::string(_buffer));
+	}
+}
@@ -0,0 +1,120 @@
+#include "esr_test.h"
+#include <esr_kernel.h>
+#include <vector>
+
+using namespace esr;
+
+const message MSG_TEST = MSG_USER + 1;
+
+static uint16_t _received;
+
+static void record_thread(message msg, message_param param)
+{
+	if(msg == MSG_TEST)
+	{
+		++_received;
+	}
+}
+
+static thread_id start_thread(bool idle_loop)
+{
+	thread_id id = 0;
+	ASSERT_EQ(E_OK, begin_thread(record_thread, id));
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, idle_loop));
+	return id;
+}
+
+/**
+* Items run by deferred work, in order
+*/
+static std::vector<message_param> _work;
+
+static void record_work(message_param param)
+{
+	_work.push_back(param);
+}
+
+TEST(idle, jumps_to_deadline)
+{
+	thread_id id = start_thread(false);
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_TEST, 50));
+
+	// Nothing is ready, virtual time skips to the deadline and the timer fires within the same iteration
+	run_cycle();
+	EXPECT_EQ(50u, millis());
+
+	run_cycle();
+	EXPECT_EQ(1u, _received);
+	EXPECT_EQ(50u, millis());
+}
+
+TEST(idle, no_timers)
+{
+	start_thread(false);
+	run_cycle();
+	run_cycle();
+	EXPECT_EQ(0u, millis());
+}
+
+TEST(idle, idle_loop_keeps_running)
+{
+	thread_id id = start_thread(true);
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_TEST, 50));
+
+	run_cycle();
+	EXPECT_EQ(0u, millis());
+	EXPECT_EQ(0u, _received);
+
+	// Once the idle loop is off the scheduler sleeps again
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, false));
+	run_cycle();
+	EXPECT_EQ(50u, millis());
+}
+
+TEST(idle, pending_messages)
+{
+	thread_id id = start_thread(false);
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_TEST, 50));
+	ASSERT_EQ(E_OK, post_message(id, MSG_TEST));
+
+	run_cycle();
+	EXPECT_EQ(0u, millis());
+	EXPECT_EQ(1u, _received);
+
+	ASSERT_EQ(E_OK, post_message_from_isr(id, MSG_TEST));
+	run_cycle();
+	EXPECT_EQ(0u, millis());
+	EXPECT_EQ(2u, _received);
+
+	run_cycle();
+	EXPECT_EQ(50u, millis());
+}
+
+TEST(idle, deferred_work)
+{
+	thread_id id = start_thread(false);
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_TEST, 50));
+
+	// The same pending item is queued once
+	EXPECT_EQ(E_OK, defer(record_work, 1));
+	EXPECT_EQ(E_OK, defer(record_work, 1));
+	for(uint8_t i = 1; i < MAX_DEFERRED_WORK; ++i)
+	{
+		EXPECT_EQ(E_OK, defer(record_work, i + 1));
+	}
+
+	EXPECT_EQ(E_WORK_QUEUE_IS_FULL, defer(record_work, 100));
+
+	// One item per iteration, the scheduler doesn't sleep while work is pending
+	for(uint8_t i = 0; i < MAX_DEFERRED_WORK; ++i)
+	{
+		EXPECT_EQ(0u, millis());
+		run_cycle();
+		ASSERT_EQ(i + 1u, _work.size());
+		EXPECT_EQ(i + 1u, _work[i]);
+	}
+
+	EXPECT_EQ(0u, millis());
+	run_cycle();
+	EXPECT_EQ(50u, millis());
+}
@@ -0,0 +1,181 @@
+#include "esr_test.h"
+#include <esr_kernel.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace esr;
+
+const message MSG_TEST = MSG_USER + 1;
+
+static std::vector<message_param> _received;
+
+/**
+* Simulated interrupt: posts a burst of messages with consecutive parameters, counts accepted ones
+*/
+static thread_id _isr_target;
+static message_param _isr_sent;
+static uint32_t _isr_attempts;
+static bool _nested_interrupts;
+
+static void interrupt(uint8_t burst)
+{
+	for(uint8_t i = 0; i < burst; ++i)
+	{
+		++_isr_attempts;
+		if(post_message_from_isr(_isr_target, MSG_TEST, _isr_sent) == E_OK)
+		{
+			++_isr_sent;
+		}
+	}
+}
+
+static void record_thread(message msg, message_param param)
+{
+	if(msg == MSG_TEST)
+	{
+		_received.push_back(param);
+
+		// Interrupts fire while messages are being processed too
+		if(_nested_interrupts && rand() % 4 == 0)
+		{
+			interrupt(rand() % 3);
+		}
+	}
+}
+
+static thread_id start_thread()
+{
+	thread_id id = 0;
+	ASSERT_EQ(E_OK, begin_thread(record_thread, id));
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, false));
+	return id;
+}
+
+/**
+* One entry of the interrupt message queue is always free, it tells a full queue from an empty one
+*/
+const uint8_t ISR_CAPACITY = __ESR_ISR_QUEUE - 1;
+
+TEST(isr, full_and_dropped)
+{
+	thread_id id = start_thread();
+	for(uint8_t i = 0; i < ISR_CAPACITY; ++i)
+	{
+		EXPECT_EQ(E_OK, post_message_from_isr(id, MSG_TEST, i));
+	}
+
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message_from_isr(id, MSG_TEST, 100));
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message_from_isr(id, MSG_TEST, 101));
+
+	kernel_stats stats;
+	get_kernel_stats(stats);
+	EXPECT_EQ(2u, stats.dropped_isr_messages);
+
+	// Messages move into the thread's queue, the interrupt queue is empty again
+	run_cycle();
+	EXPECT_EQ(E_OK, post_message_from_isr(id, MSG_TEST, ISR_CAPACITY));
+
+	for(uint8_t i = 0; i < 2 * ISR_CAPACITY; ++i)
+	{
+		run_cycle();
+	}
+
+	ASSERT_EQ(ISR_CAPACITY + 1u, _received.size());
+	for(uint8_t i = 0; i < _received.size(); ++i)
+	{
+		EXPECT_EQ(static_cast<message_param>(i), _received[i]);
+	}
+
+	reset_stats();
+	get_kernel_stats(stats);
+	EXPECT_EQ(0u, stats.dropped_isr_messages);
+}
+
+TEST(isr, wrap_around)
+{
+	thread_id id = start_thread();
+
+	// Head and tail indexes wrap around many times, messages keep their order
+	message_param sent = 0;
+	for(uint16_t i = 0; i < 300; ++i)
+	{
+		for(uint8_t j = 0; j < 2; ++j)
+		{
+			ASSERT_EQ(E_OK, post_message_from_isr(id, MSG_TEST, sent));
+			++sent;
+		}
+
+		run_cycle();
+		run_cycle();
+	}
+
+	ASSERT_EQ(sent, _received.size());
+	for(uint16_t i = 0; i < _received.size(); ++i)
+	{
+		EXPECT_EQ(static_cast<message_param>(i), _received[i]);
+	}
+
+	kernel_stats stats;
+	get_kernel_stats(stats);
+	EXPECT_EQ(0u, stats.dropped_isr_messages);
+}
+
+TEST(isr, wrong_arguments)
+{
+	thread_id id = start_thread();
+	EXPECT_EQ(E_WRONG_MESSAGE, post_message_from_isr(id, MSG_TIMER));
+	EXPECT_EQ(E_WRONG_THREAD, post_message_from_isr(THREAD_CURRENT, MSG_TEST));
+}
+
+TEST(isr, full_thread_queue)
+{
+	// A message that doesn't fit into the thread's queue is dropped when it's moved out of the interrupt queue
+	thread_id id = start_thread();
+	ASSERT_EQ(E_OK, set_thread_queue_size(id, 1));
+	ASSERT_EQ(E_OK, post_message_from_isr(id, MSG_TEST, 0));
+	ASSERT_EQ(E_OK, post_message_from_isr(id, MSG_TEST, 1));
+
+	for(uint8_t i = 0; i < 4; ++i)
+	{
+		run_cycle();
+	}
+
+	ASSERT_EQ(1u, _received.size());
+	EXPECT_EQ(0u, _received[0]);
+
+	thread_stats stats;
+	ASSERT_EQ(E_OK, get_thread_stats(id, stats));
+	EXPECT_EQ(1u, stats.dropped_messages);
+}
+
+TEST(isr, hammer)
+{
+	// Random bursts of interrupts between and during scheduler loop iterations: 
+	// every message is either delivered once and in order or counted as dropped
+	_isr_target = start_thread();
+	_nested_interrupts = true;
+	ASSERT_EQ(E_OK, set_thread_drain(_isr_target, DRAIN_ALL));
+	srand(1);
+	for(uint16_t i = 0; i < 10000; ++i)
+	{
+		interrupt(rand() % (__ESR_ISR_QUEUE + 2));
+		run_cycle();
+	}
+
+	for(uint8_t i = 0; i < 4; ++i)
+	{
+		run_cycle();
+	}
+
+	ASSERT_EQ(_isr_sent, _received.size());
+	for(uint32_t i = 0; i < _received.size(); ++i)
+	{
+		ASSERT_EQ(i, _received[i]);
+	}
+
+	kernel_stats stats;
+	get_kernel_stats(stats);
+	EXPECT_TRUE(_isr_sent > 10000);
+	EXPECT_TRUE(stats.dropped_isr_messages > 0);
+	EXPECT_EQ(_isr_attempts - _isr_sent, static_cast<uint32_t>(stats.dropped_isr_messages));
+}
@@ -0,0 +1,192 @@
+#include "esr_test.h"
+#include <esr_io.h>
+#include <esr_kernel.h>
+#include <stdio.h>
+
+using namespace esr;
+
+/**
+* Output stream that takes a limited amount of bytes without waiting
+*/
+class slow_print : public string_print
+{
+public:
+	int room;
+
+	slow_print() : room(0x7FFF)
+	{
+	}
+
+	int availableForWrite() { return room; }
+};
+
+/**
+* Writes buffered messages into the log stream
+*/
+static void flush()
+{
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	log_flush();
+#endif
+}
+
+TEST(log, text)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	uint32_t ul = 4000000000u;
+	int32_t l = -100000;
+	float f = 1.5f;
+	// Error codes are written as numbers unless __ESR_ENABLE_ERROR_FORMATTING is defined
+	EXPECT_EQ(E_OK, log(LOG_INFO, F("%c %s %ps %e|%b %ub %d %ud|%l %ul %f|%xb %xd %xl|%%"), 
+		'a', "str", F("pgm"), E_WRONG_THREAD, 
+		static_cast<int8_t>(-5), static_cast<uint8_t>(200), static_cast<int16_t>(-1000), static_cast<uint16_t>(60000), 
+		&l, &ul, &f, 
+		static_cast<uint8_t>(0xAB), static_cast<uint16_t>(0xBEEF), &ul));
+	EXPECT_EQ(E_OK, log(LOG_ERROR, "ram %ub", static_cast<uint8_t>(7)));
+	flush();
+
+	EXPECT_EQ(std::string(
+		"INFRM\ta str pgm E_2|-5 200 -1000 60000|-100000 4000000000 1.50|AB BEEF EE6B2800|%\r\n"
+		"ERROR\tram 7\r\n"), out.text);
+}
+
+TEST(log, levels)
+{
+	string_print out;
+	EXPECT_EQ(E_LOG_CONFIGURATION_IS_INCORRECT, log(LOG_INFO, F("not initialized")));
+
+	ASSERT_EQ(E_OK, log_init(out, LOG_INFO));
+	EXPECT_EQ(E_OK, log(LOG_DEBUG, F("filtered")));
+
+	const log_module MODULE = 1;
+	ASSERT_EQ(E_OK, set_log_level(MODULE, LOG_ERROR));
+	EXPECT_EQ(LOG_ERROR, get_log_level(MODULE));
+	EXPECT_EQ(E_OK, log(LOG_INFO, MODULE, F("filtered")));
+	EXPECT_EQ(E_OK, log(LOG_ERROR, MODULE, F("module")));
+	EXPECT_EQ(E_OK, log(LOG_INFO, F("default")));
+
+	ASSERT_EQ(E_OK, set_log_level(MODULE, LOG_DISABLED));
+	EXPECT_EQ(E_OK, log(LOG_ERROR, MODULE, F("filtered")));
+	EXPECT_EQ(E_WRONG_LOG_MODULE, set_log_level(LOG_MODULES, LOG_INFO));
+	flush();
+
+	EXPECT_EQ(std::string("ERROR\tmodule\r\nINFRM\tdefault\r\n"), out.text);
+}
+
+TEST(log, unknown_placeholder)
+{
+	string_print out;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+	EXPECT_EQ(E_INCORRECT_FORMAT, log(LOG_INFO, F("value %q"), 1));
+	EXPECT_EQ(E_INCORRECT_FORMAT, log(LOG_INFO, F("value %uq"), 1));
+	EXPECT_EQ(E_INCORRECT_FORMAT, log(LOG_INFO, "value %q", 1));
+	EXPECT_EQ(E_OK, log(LOG_INFO, F("next")));
+	flush();
+
+	// The message is cut at the placeholder, the next one starts on its own line
+	EXPECT_EQ(std::string("INFRM\tvalue \r\nINFRM\tvalue \r\nINFRM\tvalue \r\nINFRM\tnext\r\n"), out.text);
+}
+
+#ifdef __ESR_ENABLE_LOG_BUFFER
+
+TEST(log, buffer_slow_stream)
+{
+	// The stream takes one byte per scheduler loop iteration, messages don't fit into the buffer
+	slow_print out;
+	out.room = 1;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	std::string expected;
+	for(uint8_t i = 0; i < 20; ++i)
+	{
+		EXPECT_EQ(E_OK, log(LOG_INFO, F("message number %ub"), i));
+
+		char line[32];
+		snprintf(line, sizeof(line), "INFRM\tmessage number %u\r\n", i);
+		expected += line;
+	}
+
+	// Nothing is written before the scheduler loop runs, except messages that made room for newer ones
+	EXPECT_TRUE(out.text.size() < expected.size());
+	for(uint16_t i = 0; i < 1000 && out.text.size() < expected.size(); ++i)
+	{
+		run_cycle();
+	}
+
+	EXPECT_EQ(expected, out.text);
+	EXPECT_EQ(0u, get_dropped_log_messages());
+}
+
+static void timer_thread(message msg, message_param param)
+{
+}
+
+TEST(log, buffer_full_stream_sleeps)
+{
+	// Messages waiting for room in the stream don't keep the kernel awake: virtual time jumps to the deadline
+	slow_print out;
+	out.room = 0;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	thread_id id = 0;
+	ASSERT_EQ(E_OK, begin_thread(timer_thread, id));
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, false));
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_USER, 1000));
+
+	EXPECT_EQ(E_OK, log(LOG_INFO, F("waiting")));
+	run_cycle();
+	run_cycle();
+	run_cycle();
+	EXPECT_EQ(1000u, millis());
+	EXPECT_EQ(std::string(), out.text);
+
+	// The stream takes bytes again, the scheduler loop writes the message
+	out.room = 0x7FFF;
+	run_cycle();
+	EXPECT_EQ(std::string("INFRM\twaiting\r\n"), out.text);
+	EXPECT_EQ(1000u, millis());
+}
+
+#endif
+
+#ifdef __ESR_ENABLE_THREAD_STATS
+
+static void idle_thread(message msg, message_param param)
+{
+}
+
+TEST(log, stats_dump)
+{
+	// A dump is longer than the log buffer, no line is lost
+	slow_print out;
+	out.room = 1;
+	ASSERT_EQ(E_OK, log_init(out, LOG_DEBUG));
+
+	for(uint8_t i = 0; i < MAX_THREADS; ++i)
+	{
+		thread_id id = 0;
+		ASSERT_EQ(E_OK, begin_thread(idle_thread, id));
+	}
+
+	run_cycle();
+	log_stats();
+	log_memory_usage();
+	flush();
+
+	uint8_t lines = 0;
+	for(size_t i = 0; i < out.text.size(); ++i)
+	{
+		lines += out.text[i] == '\n';
+	}
+
+	EXPECT_EQ(MAX_THREADS + 2u, lines);
+	EXPECT_TRUE(out.text.find("load=") != std::string::npos);
+	EXPECT_TRUE(out.text.find("total=") != std::string::npos);
+#ifdef __ESR_ENABLE_LOG_BUFFER
+	EXPECT_EQ(0u, get_dropped_log_messages());
+#endif
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "esr_test.h"
+#include <esr_kernel.h>
+#include <vector>
+
+using namespace esr;
+
+const message MSG_TEST = MSG_USER + 1;
+
+/**
+* Messages received by record_thread()
+*/
+static std::vector<message_param> _received;
+
+static void record_thread(message msg, message_param param)
+{
+	if(msg == MSG_TEST)
+	{
+		_received.push_back(param);
+	}
+}
+
+/**
+* Starts a thread that receives messages only (without idle loop)
+*/
+static thread_id start_thread()
+{
+	thread_id id = 0;
+	ASSERT_EQ(E_OK, begin_thread(record_thread, id));
+	ASSERT_EQ(E_OK, set_thread_flag(id, THREAD_IDLE_LOOP, false));
+	return id;
+}
+
+TEST(mailbox, full)
+{
+	thread_id id = start_thread();
+	for(uint8_t i = 0; i < MAX_THREAD_QUEUE; ++i)
+	{
+		EXPECT_EQ(E_OK, post_message(id, MSG_TEST, i));
+	}
+
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message(id, MSG_TEST, 100));
+
+	// One message per iteration frees one entry
+	run_cycle();
+	EXPECT_EQ(1u, _received.size());
+	EXPECT_EQ(E_OK, post_message(id, MSG_TEST, MAX_THREAD_QUEUE));
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message(id, MSG_TEST, 100));
+}
+
+TEST(mailbox, fifo_and_empty)
+{
+	thread_id id = start_thread();
+	for(uint8_t i = 0; i < 3 * MAX_THREAD_QUEUE; ++i)
+	{
+		// The ring buffer wraps around
+		EXPECT_EQ(E_OK, post_message(id, MSG_TEST, i));
+		run_cycle();
+	}
+
+	ASSERT_EQ(3u * MAX_THREAD_QUEUE, _received.size());
+	for(uint8_t i = 0; i < _received.size(); ++i)
+	{
+		EXPECT_EQ(static_cast<message_param>(i), _received[i]);
+	}
+
+	// An empty queue delivers nothing
+	run_cycle();
+	run_cycle();
+	EXPECT_EQ(3u * MAX_THREAD_QUEUE, _received.size());
+}
+
+TEST(mailbox, pool_fits_all_threads)
+{
+	thread_id ids[MAX_THREADS];
+	for(uint8_t i = 0; i < MAX_THREADS; ++i)
+	{
+		ids[i] = start_thread();
+	}
+
+	// Every thread gets a full queue out of the default pool
+	for(uint8_t i = 0; i < MAX_THREADS; ++i)
+	{
+		for(uint8_t j = 0; j < MAX_THREAD_QUEUE; ++j)
+		{
+			EXPECT_EQ(E_OK, post_message(ids[i], MSG_TEST, j));
+		}
+
+		EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message(ids[i], MSG_TEST));
+	}
+
+	thread_id id = 0;
+	EXPECT_EQ(E_NO_FREE_THREAD_SLOTS, begin_thread(record_thread, id));
+}
+
+TEST(mailbox, queue_size)
+{
+	thread_id id = start_thread();
+	EXPECT_EQ(E_WRONG_QUEUE_SIZE, set_thread_queue_size(id, 0));
+	EXPECT_EQ(E_WRONG_QUEUE_SIZE, set_thread_queue_size(id, MAX_THREAD_QUEUE + 1));
+
+	// Pending messages survive resizing
+	EXPECT_EQ(E_OK, post_message(id, MSG_TEST, 1));
+	ASSERT_EQ(E_OK, set_thread_queue_size(id, 1));
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, post_message(id, MSG_TEST, 2));
+
+	run_cycle();
+	ASSERT_EQ(1u, _received.size());
+	EXPECT_EQ(1u, _received[0]);
+}
+
+TEST(mailbox, coalescing)
+{
+	thread_id id = start_thread();
+	ASSERT_EQ(E_OK, set_message_coalescing(MSG_TEST, true));
+
+	// A pending message gets the latest parameter instead of taking another entry
+	EXPECT_EQ(E_OK, post_message(id, MSG_TEST, 1));
+	EXPECT_EQ(E_OK, post_message(id, MSG_TEST, 2));
+	EXPECT_EQ(E_OK, post_message(id, MSG_TEST, 3));
+
+	run_cycle();
+	run_cycle();
+	ASSERT_EQ(1u, _received.size());
+	EXPECT_EQ(3u, _received[0]);
+}
+
+TEST(mailbox, wrong_thread)
+{
+	thread_id id = start_thread();
+	EXPECT_EQ(E_WRONG_THREAD, post_message(MAX_THREADS, MSG_TEST));
+	EXPECT_EQ(E_WRONG_THREAD, post_message(id + 1, MSG_TEST));
+	EXPECT_EQ(E_WRONG_MESSAGE, post_message(id, MSG_TIMER));
+
+	ASSERT_EQ(E_OK, kill_thread(id));
+	EXPECT_EQ(E_WRONG_THREAD, post_message(id, MSG_TEST));
+}
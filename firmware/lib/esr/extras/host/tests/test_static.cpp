@@ -0,0 +1,92 @@
+#include "esr_test.h"
+#include <esr.h>
+#include <vector>
+
+using namespace esr;
+
+const message MSG_TEST = MSG_USER + 1;
+
+/**
+* Parameters received by sink threads
+*/
+static std::vector<message_param> _received;
+
+struct sink : static_thread<2>
+{
+	static void thread_func(message msg, message_param param)
+	{
+		_received.push_back(param);
+	}
+};
+
+struct other_sink : sink
+{
+};
+
+typedef static_kernel<sink, other_sink> first_kernel;
+typedef static_kernel<other_sink, sink, sink> second_kernel;
+
+TEST(static_kernel, post_by_type)
+{
+	EXPECT_EQ(E_OK, first_kernel::post<sink>(MSG_TEST, 1));
+	EXPECT_EQ(E_OK, first_kernel::post<other_sink>(MSG_TEST, 2));
+	EXPECT_EQ(E_WRONG_MESSAGE, first_kernel::post<sink>(MSG_IDLE));
+
+	// Threads receive messages in order of their positions
+	first_kernel::run_cycle();
+	ASSERT_EQ(2u, _received.size());
+	EXPECT_EQ(1u, _received[0]);
+	EXPECT_EQ(2u, _received[1]);
+}
+
+TEST(static_kernel, mailbox_full)
+{
+	EXPECT_EQ(E_OK, first_kernel::post_message(0, MSG_TEST, 1));
+	EXPECT_EQ(E_OK, first_kernel::post_message(0, MSG_TEST, 2));
+	EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, first_kernel::post_message(0, MSG_TEST, 3));
+	EXPECT_EQ(E_WRONG_THREAD, first_kernel::post_message(2, MSG_TEST));
+	EXPECT_EQ(E_WRONG_THREAD, first_kernel::post_message(8, MSG_TEST));
+
+	// One message per thread per iteration
+	first_kernel::run_cycle();
+	first_kernel::run_cycle();
+	first_kernel::run_cycle();
+	ASSERT_EQ(2u, _received.size());
+	EXPECT_EQ(1u, _received[0]);
+	EXPECT_EQ(2u, _received[1]);
+}
+
+TEST(static_kernel, mailboxes_per_position)
+{
+	// The same thread type in two kernels and twice in one kernel: every position has its own mailbox
+	for(thread_id id = 0; id < 3; ++id)
+	{
+		EXPECT_EQ(E_OK, second_kernel::post_message(id, MSG_TEST, 10 + id));
+		EXPECT_EQ(E_OK, second_kernel::post_message(id, MSG_TEST, 20 + id));
+		EXPECT_EQ(E_MESSAGE_QUEUE_IS_FULL, second_kernel::post_message(id, MSG_TEST));
+	}
+
+	EXPECT_EQ(E_OK, first_kernel::post<sink>(MSG_TEST, 1));
+	EXPECT_EQ(E_OK, first_kernel::post<sink>(MSG_TEST, 2));
+
+	first_kernel::run_cycle();
+	ASSERT_EQ(1u, _received.size());
+	EXPECT_EQ(1u, _received[0]);
+
+	second_kernel::run_cycle();
+	second_kernel::run_cycle();
+	second_kernel::run_cycle();
+	ASSERT_EQ(7u, _received.size());
+	EXPECT_EQ(10u, _received[1]);
+	EXPECT_EQ(11u, _received[2]);
+	EXPECT_EQ(12u, _received[3]);
+	EXPECT_EQ(20u, _received[4]);
+	EXPECT_EQ(21u, _received[5]);
+	EXPECT_EQ(22u, _received[6]);
+
+	// A type at one position only is posted by type
+	EXPECT_EQ(E_OK, second_kernel::post<other_sink>(MSG_TEST, 3));
+	second_kernel::run_cycle();
+	ASSERT_EQ(8u, _received.size());
+	EXPECT_EQ(3u, _received[7]);
+}
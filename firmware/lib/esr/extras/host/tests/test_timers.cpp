@@ -0,0 +1,207 @@
+#include "esr_test.h"
+#include <esr_kernel.h>
+#include <vector>
+
+using namespace esr;
+
+const message MSG_FIRST = MSG_USER + 1;
+const message MSG_SECOND = MSG_USER + 2;
+const message MSG_THIRD = MSG_USER + 3;
+
+/**
+* A received message and the time it has been received at
+*/
+struct delivery
+{
+	message msg;
+	timer_period time;
+};
+
+static std::vector<delivery> _deliveries;
+
+/**
+* Thread started by start_thread()
+*/
+static thread_id _thread;
+
+static void record_thread(message msg, message_param param)
+{
+	if(msg != MSG_IDLE)
+	{
+		delivery d = { msg, millis() };
+		_deliveries.push_back(d);
+	}
+}
+
+static thread_id start_thread()
+{
+	ASSERT_EQ(E_OK, begin_thread(record_thread, _thread));
+	ASSERT_EQ(E_OK, set_thread_flag(_thread, THREAD_IDLE_LOOP, false));
+	return _thread;
+}
+
+/**
+* Runs scheduler loop iterations: the first one fires due timers (or skips virtual time to the next deadline), 
+* the second one delivers messages posted by timers
+*/
+static void run_step()
+{
+	run_cycle();
+	run_cycle();
+}
+
+/**
+* Runs scheduler loop until the specified time in 1 ms steps. 
+* The idle loop of the thread keeps the scheduler from skipping virtual time to the next deadline meanwhile
+* @param time time in milliseconds
+*/
+static void run_until(timer_period time)
+{
+	ASSERT_EQ(E_OK, set_thread_flag(_thread, THREAD_IDLE_LOOP, true));
+	while(millis() < time)
+	{
+		run_step();
+		host::advance_us(1000);
+	}
+
+	run_step();
+	ASSERT_EQ(E_OK, set_thread_flag(_thread, THREAD_IDLE_LOOP, false));
+}
+
+TEST(timers, deadline_order)
+{
+	thread_id id = start_thread();
+
+	// Posted out of order, delivered in order of deadlines
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_THIRD, 30));
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_FIRST, 10));
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_SECOND, 20));
+
+	timer_period deadline = 0;
+	ASSERT_EQ(E_OK, next_deadline(deadline));
+	EXPECT_EQ(10u, deadline);
+
+	run_until(40);
+	ASSERT_EQ(3u, _deliveries.size());
+	EXPECT_EQ(MSG_FIRST, _deliveries[0].msg);
+	EXPECT_EQ(10u, _deliveries[0].time);
+	EXPECT_EQ(MSG_SECOND, _deliveries[1].msg);
+	EXPECT_EQ(20u, _deliveries[1].time);
+	EXPECT_EQ(MSG_THIRD, _deliveries[2].msg);
+	EXPECT_EQ(30u, _deliveries[2].time);
+}
+
+TEST(timers, cancel)
+{
+	thread_id id = start_thread();
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_FIRST, 10));
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_SECOND, 20));
+	ASSERT_EQ(E_OK, cancel_message(id, MSG_FIRST));
+
+	run_until(30);
+	ASSERT_EQ(1u, _deliveries.size());
+	EXPECT_EQ(MSG_SECOND, _deliveries[0].msg);
+}
+
+TEST(timers, pool_exhausted)
+{
+	thread_id id = start_thread();
+	for(uint8_t i = 0; i < MAX_TIMERS; ++i)
+	{
+		EXPECT_EQ(E_OK, post_message_after(id, MSG_FIRST, 10 + i));
+	}
+
+	EXPECT_EQ(E_NO_FREE_TIMERS, post_message_after(id, MSG_FIRST, 100));
+
+	// Fired delivery timers are released
+	run_until(10 + MAX_TIMERS);
+	EXPECT_EQ(E_OK, post_message_after(id, MSG_FIRST, 100));
+}
+
+/**
+* Starts a 10 ms periodic timer, misses its deadlines until 35 ms and runs scheduler loop once
+* @param policy catch-up policy
+*/
+static void miss_deadlines(catch_up_policy policy)
+{
+	thread_id id = start_thread();
+	timer_id timer = 0;
+	ASSERT_EQ(E_OK, create_timer(id, MSG_FIRST, timer));
+	ASSERT_EQ(E_OK, start_timer(timer, 10, 10, policy));
+
+	host::set_time_us(35000);
+	run_cycle();
+}
+
+TEST(timers, catch_up_skip)
+{
+	miss_deadlines(CATCH_UP_SKIP);
+	EXPECT_EQ(1u, _deliveries.size());
+
+	// The schedule is kept, missed deadlines are skipped
+	timer_period deadline = 0;
+	ASSERT_EQ(E_OK, next_deadline(deadline));
+	EXPECT_EQ(40u, deadline);
+}
+
+TEST(timers, catch_up_burst)
+{
+	miss_deadlines(CATCH_UP_BURST);
+
+	// Deadlines at 10, 20 and 30 ms are delivered back to back
+	EXPECT_EQ(3u, _deliveries.size());
+
+	timer_period deadline = 0;
+	ASSERT_EQ(E_OK, next_deadline(deadline));
+	EXPECT_EQ(40u, deadline);
+}
+
+TEST(timers, catch_up_restart)
+{
+	miss_deadlines(CATCH_UP_RESTART);
+	EXPECT_EQ(1u, _deliveries.size());
+
+	// The schedule starts over from the late invocation
+	timer_period deadline = 0;
+	ASSERT_EQ(E_OK, next_deadline(deadline));
+	EXPECT_EQ(45u, deadline);
+}
+
+TEST(timers, thread_timer)
+{
+	thread_id id = start_thread();
+	ASSERT_EQ(E_OK, set_timer_ms(id, 10));
+
+	run_until(35);
+	ASSERT_EQ(3u, _deliveries.size());
+	for(uint8_t i = 0; i < _deliveries.size(); ++i)
+	{
+		EXPECT_EQ(MSG_TIMER, _deliveries[i].msg);
+		EXPECT_EQ(10u * (i + 1), _deliveries[i].time);
+	}
+
+	ASSERT_EQ(E_OK, clear_timer(id));
+	run_until(60);
+	EXPECT_EQ(3u, _deliveries.size());
+}
+
+TEST(timers, millis_overflow)
+{
+	// Deadlines are compared with respect to millis() overflow
+	host::set_time_us(static_cast<uint64_t>(0xFFFFFFF0u) * 1000);
+	thread_id id = start_thread();
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_SECOND, 32));
+	ASSERT_EQ(E_OK, post_message_after(id, MSG_FIRST, 8));
+
+	// Idle scheduler loop skips virtual time to the next deadline
+	run_step();
+	ASSERT_EQ(1u, _deliveries.size());
+	EXPECT_EQ(MSG_FIRST, _deliveries[0].msg);
+	EXPECT_EQ(0xFFFFFFF8u, _deliveries[0].time);
+
+	// millis() wraps around
+	run_step();
+	ASSERT_EQ(2u, _deliveries.size());
+	EXPECT_EQ(MSG_SECOND, _deliveries[1].msg);
+	EXPECT_EQ(0x10u, _deliveries[1].time);
+}
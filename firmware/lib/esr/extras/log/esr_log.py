@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Binary log decoder:
+===================
+Formats a log written with __ESR_ENABLE_BINARY_LOGGING. Format strings are taken from the firmware ELF file
+(binary log frames carry flash addresses of format strings). Text lines in the stream are passed as is.
+
+	python3 esr_log.py weatherhub_fw.elf capture.bin
+	cat /dev/ttyUSB0 | python3 esr_log.py weatherhub_fw.elf
+
+The ELF file must be the one the firmware has been built from, otherwise format strings are not found.
+Format string addresses are pointer-sized on non-AVR platforms (4 or 8 bytes, as the ELF class says).
+Host builds have to be linked with -no-pie: strings of a position-independent executable are relocated
+at run time, so logged addresses don't match the ELF file.
+Error names of %e are read from esr_errors.h next to this script (see --errors).
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+LOG_FRAME_MARKER = 0xA5
+LEVELS = ["DEBUG", "INFRM", "ERROR", "KERNL"]
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 2
+EM_AVR = 83
+
+
+class Elf:
+	"""Reads null-terminated strings from allocated sections of an ELF file by their addresses"""
+
+	def __init__(self, path):
+		with open(path, "rb") as f:
+			self.data = f.read()
+
+		if self.data[:4] != b"\x7fELF":
+			raise ValueError("%s is not an ELF file" % path)
+
+		is_64 = self.data[4] == 2
+		endian = "<" if self.data[5] == 1 else ">"
+		machine = struct.unpack_from(endian + "H", self.data, 18)[0]
+
+		if is_64:
+			shoff, = struct.unpack_from(endian + "Q", self.data, 40)
+			shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 58)
+			section_format = endian + "IIQQQQ"
+		else:
+			shoff, = struct.unpack_from(endian + "I", self.data, 32)
+			shentsize, shnum = struct.unpack_from(endian + "HH", self.data, 46)
+			section_format = endian + "IIIIII"
+
+		self.sections = []
+		for i in range(shnum):
+			name, type, flags, address, offset, size = struct.unpack_from(section_format, self.data, shoff + i * shentsize)
+			# AVR RAM addresses start at 0x800000, format strings are in flash
+			if type == SHT_PROGBITS and flags & SHF_ALLOC and not (machine == EM_AVR and address >= 0x800000):
+				self.sections.append((address, offset, size))
+
+		# Format string addresses are 16-bit on AVR, pointer-sized elsewhere
+		if machine == EM_AVR:
+			self.address_size = 2
+		else:
+			self.address_size = 8 if is_64 else 4
+
+	def string(self, address):
+		for start, offset, size in self.sections:
+			if start <= address < start + size:
+				begin = offset + address - start
+				end = self.data.find(b"\0", begin, offset + size)
+				if end < 0:
+					return None
+				return self.data[begin:end].decode("latin-1")
+		return None
+
+
+class Arguments:
+	"""Raw arguments of a log frame"""
+
+	def __init__(self, data):
+		self.data = data
+		self.position = 0
+
+	def take(self, format):
+		values = struct.unpack_from("<" + format, self.data, self.position)
+		self.position += struct.calcsize(format)
+		return values[0]
+
+	def take_string(self):
+		end = self.data.find(b"\0", self.position)
+		if end < 0:
+			end = len(self.data)
+		value = self.data[self.position:end].decode("latin-1")
+		self.position = end + 1
+		return value
+
+
+def read_error_names(path):
+	"""Reads error code names from the error enumeration of esr_errors.h"""
+	with open(path) as f:
+		text = f.read()
+
+	names = {}
+	value = 0
+	for name, initializer in re.findall(r"^\s*(E_\w+)\s*(?:=\s*(\w+))?\s*,?\s*$", text, re.MULTILINE):
+		if initializer:
+			value = int(initializer, 0)
+		names[value] = name
+		value += 1
+	return names
+
+
+def format_message(elf, errors, format, args):
+	"""Formats a message the way esr::log() prints it"""
+	address_format = {2: "H", 4: "I", 8: "Q"}[elf.address_size]
+	result = []
+	i = 0
+	while i < len(format):
+		c = format[i]
+		i += 1
+		if c != "%":
+			result.append(c)
+			continue
+
+		code = format[i] if i < len(format) else ""
+		extra = format[i + 1] if i + 1 < len(format) else ""
+		i += 1
+
+		if code == "%":
+			result.append("%")
+		elif code == "c":
+			result.append(chr(args.take("B")))
+		elif code == "s":
+			result.append(args.take_string())
+		elif code == "p" and extra == "s":
+			result.append(elf.string(args.take(address_format)) or "?")
+			i += 1
+		elif code == "e":
+			error = args.take("B")
+			result.append(errors.get(error, "E_%X" % error))
+		elif code == "b":
+			result.append(str(args.take("b")))
+		elif code == "d":
+			result.append(str(args.take("h")))
+		elif code == "l":
+			result.append(str(args.take("i")))
+		elif code == "f":
+			result.append("%.2f" % args.take("f"))
+		elif code in ("u", "x") and extra in ("b", "d", "l"):
+			value = args.take({"b": "B", "d": "H", "l": "I"}[extra])
+			result.append(str(value) if code == "u" else "%X" % value)
+			i += 1
+		elif code != "":
+			raise ValueError("incorrect placeholder %%%s%s" % (code, extra))
+
+	return "".join(result)
+
+
+def read_exactly(stream, size):
+	data = stream.read(size)
+	while len(data) < size:
+		chunk = stream.read(size - len(data))
+		if not chunk:
+			return None
+		data += chunk
+	return data
+
+
+def decode(elf, errors, stream, output):
+	text = bytearray()
+	while True:
+		b = stream.read(1)
+		if not b:
+			break
+
+		if b[0] != LOG_FRAME_MARKER:
+			if b == b"\n":
+				output.write(text.decode("latin-1").rstrip("\r") + "\n")
+				output.flush()
+				text = bytearray()
+			else:
+				text += b
+			continue
+
+		frame = read_exactly(stream, 1 + elf.address_size + 4)
+		if frame is None:
+			break
+
+		level = frame[0] >> 6
+		size = frame[0] & 0x3F
+		address = int.from_bytes(frame[1:1 + elf.address_size], "little")
+		time = int.from_bytes(frame[1 + elf.address_size:], "little")
+		data = read_exactly(stream, size) if size > 0 else b""
+		if data is None:
+			break
+
+		format = elf.string(address)
+		if format is None:
+			message = "<unknown format 0x%X: %s>" % (address, data.hex())
+		else:
+			try:
+				message = format_message(elf, errors, format, Arguments(data))
+			except (ValueError, struct.error) as e:
+				message = "<%s: %s: %s>" % (format, e, data.hex())
+
+		output.write("%d.%03d\t%s\t%s\n" % (time // 1000, time % 1000, LEVELS[level], message))
+		output.flush()
+
+	if text:
+		output.write(text.decode("latin-1") + "\n")
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Format esr binary log")
+	parser.add_argument("elf", help="firmware ELF file")
+	parser.add_argument("input", nargs="?", help="binary log capture (stdin by default)")
+	parser.add_argument("--errors", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "esr_errors.h"),
+		help="esr_errors.h with error code names")
+	args = parser.parse_args()
+
+	elf = Elf(args.elf)
+	errors = read_error_names(args.errors)
+	source = open(args.input, "rb") if args.input else sys.stdin.buffer
+	with source:
+		decode(elf, errors, source, sys.stdout)
+
+
+if __name__ == "__main__":
+	main()
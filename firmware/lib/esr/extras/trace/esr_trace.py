@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Kernel trace decoder:
+=====================
+Converts esr::trace_dump() output into Chrome trace JSON (chrome://tracing, https://ui.perfetto.dev).
+The input is a serial port capture, lines outside of "ESR TRACE" blocks are ignored.
+Each dump becomes a separate process in the timeline, each thread is a track.
+
+	python3 esr_trace.py capture.txt -o trace.json
+	python3 esr_trace.py capture.txt -m 4=GUI_INIT -m 16=GUI_REFRESH -t 0=gui -t 3=input
+
+Timestamps are micros() of the MCU with 16 us resolution.
+"""
+
+import argparse
+import json
+import sys
+
+TRACE_SYNC = 0
+TRACE_POST = 1
+TRACE_DISPATCH_BEGIN = 2
+TRACE_DISPATCH_END = 3
+TRACE_TIMER = 4
+TRACE_QUEUE_FULL = 5
+
+SYSTEM_MESSAGES = {0: "MSG_NONE", 1: "MSG_IDLE", 2: "MSG_TIMER", 3: "MSG_FINALIZE"}
+
+
+def parse_dumps(lines):
+	"""Yields (start, events) per dump: micros() of the first event and a list of (time, type, thread, msg)"""
+	events = None
+	start = 0
+	for line in lines:
+		line = line.strip()
+		if line == "ESR TRACE END":
+			if events is not None:
+				yield start, events
+			events = None
+		elif line.startswith("ESR TRACE "):
+			fields = line.split()
+			start = int(fields[3]) if len(fields) > 3 else 0
+			events = []
+		elif events is not None and len(line) == 10:
+			try:
+				raw = bytes.fromhex(line)
+			except ValueError:
+				continue
+			events.append(((raw[0] << 8) | raw[1], raw[2], raw[3], raw[4]))
+
+
+def unwrap(start, events):
+	"""Yields (time_us, type, thread, msg) with 16-bit timestamps expanded to microseconds"""
+	high = start >> 20
+	previous = None
+	for time, type, thread, msg in events:
+		if type == TRACE_SYNC:
+			# Sync carries bits 20..31 of micros(), keep the time monotonic across micros() overflow
+			synced = thread | (msg << 8)
+			while synced < high:
+				synced += 1 << 12
+			high = synced
+		elif previous is not None and time < previous:
+			high += 1
+		previous = time
+		yield ((high << 16) | time) << 4, type, thread, msg
+
+
+def parse_names(values):
+	names = {}
+	for value in values or []:
+		code, _, name = value.partition("=")
+		names[int(code, 0)] = name
+	return names
+
+
+def convert(dumps, messages, threads):
+	result = []
+	for pid, (start, events) in enumerate(dumps):
+		for time, type, thread, msg in unwrap(start, events):
+			if type == TRACE_SYNC:
+				continue
+
+			name = messages.get(msg, SYSTEM_MESSAGES.get(msg, "msg %d" % msg))
+			event = {"pid": pid, "tid": thread, "ts": time, "name": name, "args": {"msg": msg}}
+			if type == TRACE_DISPATCH_BEGIN:
+				event["ph"] = "B"
+			elif type == TRACE_DISPATCH_END:
+				event["ph"] = "E"
+			else:
+				event["ph"] = "i"
+				event["s"] = "t"
+				event["name"] = {
+					TRACE_POST: "post ",
+					TRACE_TIMER: "timer ",
+					TRACE_QUEUE_FULL: "queue full ",
+				}.get(type, "event %d " % type) + name
+			result.append(event)
+
+		result.append({"pid": pid, "ph": "M", "name": "process_name", "args": {"name": "dump %d" % pid}})
+		for thread, name in threads.items():
+			result.append({"pid": pid, "tid": thread, "ph": "M", "name": "thread_name", "args": {"name": name}})
+
+	return {"traceEvents": result, "displayTimeUnit": "ms"}
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Convert esr kernel trace dumps into Chrome trace JSON")
+	parser.add_argument("input", nargs="?", help="serial capture file (stdin by default)")
+	parser.add_argument("-o", "--output", help="output file (stdout by default)")
+	parser.add_argument("-m", "--message", action="append", metavar="CODE=NAME", help="message code name")
+	parser.add_argument("-t", "--thread", action="append", metavar="ID=NAME", help="thread name")
+	args = parser.parse_args()
+
+	source = open(args.input, errors="replace") if args.input else sys.stdin
+	with source:
+		dumps = list(parse_dumps(source))
+
+	trace = convert(dumps, parse_names(args.message), parse_names(args.thread))
+
+	target = open(args.output, "w") if args.output else sys.stdout
+	with target:
+		json.dump(trace, target, indent=1)
+
+	sys.stderr.write("%d dumps, %d events\n" % (len(dumps), sum(len(events) for start, events in dumps)))
+
+
+if __name__ == "__main__":
+	main()
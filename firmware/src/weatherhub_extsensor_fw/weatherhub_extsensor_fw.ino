@@ -7,6 +7,7 @@
 #include <SoftwareSerial.h>
 #include "dht.h"
 #include <stdlib.h>
+#include <esr_format.h>
 
 SoftwareSerial Serial(UART_RX, UART_TX);
 dht_driver dht(DHT_PORT);
@@ -50,39 +51,13 @@ void resp_write(const __FlashStringHelper* text)
 	Serial.print(text);
 }
 
-#ifdef TEXT_PROTOCOL
-	uint16_t power_of_10(uint8_t p)
-{
-	uint16_t r = 1;
-	for(uint8_t i = 0; i < p; ++i)
-	{
-		r *= 10;
-	}
-	return r;
-}
-
-char get_digit(uint16_t value, uint8_t index)
-{
-	uint8_t d = static_cast<uint8_t>(
-		value % power_of_10(index + 1)
-		/  power_of_10(index)
-		);
-
-	return d + '0';
-}
-#endif
-
 void resp_write(float value)
 {
 #ifdef TEXT_PROTOCOL
-	uint16_t int_value = static_cast<uint16_t>(abs( value * 10.0));
-	
-	Serial.print(value >= 0 ? '+' : '-');
-	Serial.print(get_digit(int_value, 3));
-	Serial.print(get_digit(int_value, 2));
-	Serial.print(get_digit(int_value, 1));
-	Serial.print('.');
-	Serial.print(get_digit(int_value, 0));
+	// "+ddd.d"
+	char text[esr::FLOAT_BUFFER_SIZE];
+	esr::format_float(text, value, 1, 6, esr::NUMBER_PLUS | esr::NUMBER_ZERO_PAD);
+	Serial.print(text);
 #else
 	const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
 	for (uint8_t i = 0; i < 4; i++)
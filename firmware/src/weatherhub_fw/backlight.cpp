@@ -6,12 +6,12 @@ using namespace backlight;
 
 thread_id backlight::thread;
 
-void backlight::thread_func(message msg)
+void backlight::thread_func(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_BL_INIT:
-		log(LOG_INFO, F("BL\tinit"));
+		log(LOG_INFO, MODULE_BACKLIGHT, F("BL\tinit"));
 		pinMode(BL_PIN, OUTPUT);
 		analogWrite(BL_PIN, 255);
 		break;
@@ -15,7 +15,7 @@ namespace backlight
 
 	const int BL_PIN = 9;
 
-	void thread_func(esr::message msg);
+	void thread_func(esr::message msg, esr::message_param param);
 }
 
 #endif
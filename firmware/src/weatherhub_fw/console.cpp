@@ -0,0 +1,117 @@
+#include "console.h"
+#include "globals.h"
+#include "settings.h"
+
+using namespace esr;
+using namespace console;
+
+thread_id console::thread;
+
+/**
+* Command waiting for its arguments, 0 if none
+*/
+char _command;
+
+/**
+* Arguments of the pending command
+*/
+char _arguments[2];
+uint8_t _argument_count;
+
+/**
+* Sets log level of a module and stores it in EEPROM
+* @param module module digit
+* @param level level digit
+*/
+void set_module_log_level(char module, char level)
+{
+	uint8_t m = module - '0';
+	uint8_t l = level - '0';
+	if(m >= LOG_MODULES || l > LOG_DISABLED)
+	{
+		log(LOG_ERROR, MODULE_CONSOLE, F("CONSOLE\tusage: l<module 0-%ub><level 0-%ub>"), LOG_MODULES - 1, LOG_DISABLED);
+		return;
+	}
+
+	set_log_level(m, static_cast<log_level>(l));
+	settings::set_log_level(m, static_cast<log_level>(l));
+	log(LOG_INFO, MODULE_CONSOLE, F("CONSOLE\tmodule %ub log level %ub"), m, l);
+}
+
+/**
+* Executes a single character command
+*/
+void execute(char command)
+{
+	// Collect arguments of a pending command
+	if(_command != 0)
+	{
+		_arguments[_argument_count++] = command;
+		if(_argument_count < sizeof(_arguments))
+		{
+			return;
+		}
+
+		set_module_log_level(_arguments[0], _arguments[1]);
+		_command = 0;
+		return;
+	}
+
+	switch(command)
+	{
+#ifdef __ESR_ENABLE_THREAD_STATS
+	case 's':
+		log_stats();
+#ifdef __ESR_ENABLE_LOG_BUFFER
+		log(LOG_INFO, MODULE_CONSOLE, F("CONSOLE\tlog dropped=%ud"), get_dropped_log_messages());
+#endif
+		break;
+#endif
+
+	case 'm':
+		log_memory_usage();
+		break;
+
+	case 'l':
+		_command = command;
+		_argument_count = 0;
+		break;
+
+#ifdef __ESR_ENABLE_TRACE
+	case 't':
+#ifdef __ESR_ENABLE_LOG_BUFFER
+		// Keep buffered messages ahead of the dump
+		log_flush();
+#endif
+		trace_dump(Serial);
+		break;
+#endif
+
+	case '\r':
+	case '\n':
+		break;
+
+	default:
+		log(LOG_ERROR, MODULE_CONSOLE, F("CONSOLE\tunknown command '%c'"), command);
+		break;
+	}
+}
+
+void console::thread_func(message msg, message_param param)
+{
+	switch (msg)
+	{
+	case MSG_CONSOLE_INIT:
+		log(LOG_INFO, MODULE_CONSOLE, F("CONSOLE\tinit"));
+		set_thread_flag(THREAD_CURRENT, THREAD_REPEAT_TIMER, true);
+		set_timer_ms(THREAD_CURRENT, CONSOLE_PERIOD);
+		break;
+
+	case MSG_TIMER:
+		while(Serial.available() > 0)
+		{
+			execute(static_cast<char>(Serial.read()));
+		}
+		break;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef _CONSOLE_h
+#define _CONSOLE_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+#include <esr.h>
+
+namespace console
+{
+	extern esr::thread_id thread;
+
+	/**
+	* Serial port polling period in milliseconds
+	*/
+	const long CONSOLE_PERIOD = 100;
+
+	/**
+	* Serial port commands (single characters):
+	*	s - write scheduler statistics into log (if enabled in esr_conf.h)
+	*	m - write kernel RAM usage into log
+	*	t - dump kernel trace (if enabled in esr_conf.h)
+	*	l<module><level> - set log level of a module (digits, see MODULE_* and esr::log_level), ex. l50 
+	*		turns DEBUG messages of extsensor on. The level is kept in EEPROM
+	*/
+	void thread_func(esr::message msg, esr::message_param param);
+}
+
+#endif
@@ -1,16 +1,47 @@
 #include "extsensor.h"
-#include "gui.h"
 #include "globals.h"
 #include "settings.h"
 
 using namespace esr;
 using namespace extsensor;
-using namespace extsensor::fsm;
 using namespace settings;
 
+const timer_period UPDATE_PERIOD = 10*1000;
+
+/**
+* Max time between a command and the end of its response
+*/
+const timer_period RESPONSE_TIMEOUT = 1000;
+
 thread_id		extsensor::thread;
-sensor_reading	extsensor::reading;
-state			extsensor::fsm::handler = state_initial;
+
+coroutine		driver_state;
+bool			polled;
+sensor_reading	reading;
+char			response;
+
+/**
+* Number of the current command, MSG_EXTSENSOR_TIMEOUT carries it to tell stale timeouts apart
+*/
+uint8_t			request;
+bool			timed_out;
+
+/**
+* Set once receive_line() has got a whole line, a complete response wins over a timeout that has fired meanwhile
+*/
+bool			line_received;
+
+/**
+* Set while the driver waits for a response, the interrupt ignores UART data otherwise
+*/
+volatile bool	rx_wanted;
+volatile bool	rx_pending;
+
+/**
+* Amount of received bytes the thread has been notified about. 
+* The interrupt raises it, read_byte() zeroes it, so bytes that arrive after the thread has taken some always notify it
+*/
+volatile uint8_t	rx_notified;
 
 const uint8_t	BUFFER_SIZE = 32;
 char			buffer[BUFFER_SIZE];
@@ -26,89 +57,41 @@ void buffer_reset()
 	buffer_index = 0;
 }
 
-void extsensor::fsm::state_initial()
+/**
+* Takes a received byte out of the UART buffer
+* @return byte
+*/
+char read_byte()
 {
-	log(LOG_DEBUG, F("EXTSNSR\tstate_initial"));
-	reading.status = STATUS_NO_DATA;
-
-	// Send 'U' to extsensor
-	log(LOG_INFO, F("EXTSNSR\tbegin identify"));
-	log(LOG_DEBUG, F("EXTSNSR\t> %c"), CMD_IDENTIFY);
-	uart.print(CMD_IDENTIFY);
-
-	while(uart.available() <= 0) { }
-
-	char c = uart.read();
-	log(LOG_DEBUG, F("EXTSNSR\t< %c"), c);
-	switch (c)
-	{
-	case RESP_IDENTITY:
-		{
-			buffer_reset();
-			while(true)
-			{
-				while(uart.available() <= 0) { }
-
-				char c = uart.read();
-				if(c == '\n')
-				{
-					break;
-				}
-
-				buffer[buffer_index] = c;
-				++buffer_index;
-			}
-			log(LOG_DEBUG, F("EXTSNSR\t< %s"), buffer);
-			log(LOG_DEBUG, F("EXTSNSR\tdevice identified"));
-		}
-		break;
-	default:
-		log(LOG_ERROR, F("EXTSNSR\tunknown device"));
-		
-		while(uart.available() > 0)
-		{
-			uart.read();
-		}
-		break;
-	}
-
-	// Send 'U' to extsensor
-	log(LOG_INFO, F("EXTSNSR\tbegin update"));
-	log(LOG_DEBUG, F("EXTSNSR\t> %c"), CMD_UPDATE);
-	uart.print(CMD_UPDATE);
-
-	// Enable idle loop
-	set_thread_flag(THREAD_CURRENT, THREAD_IDLE_LOOP, true);
-	extsensor::fsm::handler = state_wait_for_update;
-
-	// Send message to GUI
-	post_message(gui::thread, MSG_SENSOR_UPDATE_BEGIN);
+	// A single byte store, the interrupt never sees it half-done
+	rx_notified = 0;
+	return uart.read();
 }
 
-void extsensor::fsm::state_wait_for_update()
+/**
+* Reads available characters into buffer
+* @return true if a whole line has been received
+*/
+bool receive_line()
 {
-	if(uart.available() >= 2)
+	while(uart.available() > 0) 
 	{
-		char c = uart.read();
-		uart.read();
-		log(LOG_DEBUG, F("EXTSNSR\t< %c"), c);
-		switch (c)
+		char c = read_byte();
+		if(c == '\n')
 		{
-		case RESP_OK:
-			reading.status = STATUS_OK;
-			break;
+			ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< %s"), buffer);
+			return true;
+		}
 
-		default:
-			reading.status = STATUS_ERROR;
-			break;
+		// Keep the terminating zero
+		if(buffer_index < BUFFER_SIZE - 1)
+		{
+			buffer[buffer_index] = c;
+			++buffer_index;
 		}
-		
-		// Send 'T' to extsensor
-		log(LOG_DEBUG, F("EXTSNSR\t> %c"), CMD_GET_TEMPERATURE);
-		uart.print(CMD_GET_TEMPERATURE);
-		buffer_reset();
-		extsensor::fsm::handler = state_wait_for_t;
 	}
+
+	return false;
 }
 
 uint8_t parse_digit(char c)
@@ -129,95 +112,253 @@ uint8_t parse_digit(char c)
 	}
 }
 
-bool receive_float(float& value)
+float parse_float()
 {
-	while(uart.available() > 0) 
+	// Parse float:
+	// Format: T+000.0
+
+	float f = 0;
+	f += parse_digit(buffer[2]) * 100.0;
+	f += parse_digit(buffer[3]) * 10.0;
+	f += parse_digit(buffer[4]) * 1.0;
+	f += parse_digit(buffer[6]) * 0.1;
+
+	if(buffer[1] == '-')
 	{
-		char c = uart.read();
-		if(c == '\n')
-		{
-			log(LOG_DEBUG, F("EXTSNSR\t< %s"), buffer);
-			// Parse float:
-			// Format: T+000.0
+		f *= -1.0;
+	}
 
-			float f = 0;
-			f += parse_digit(buffer[2]) * 100.0;
-			f += parse_digit(buffer[3]) * 10.0;
-			f += parse_digit(buffer[4]) * 1.0;
-			f += parse_digit(buffer[6]) * 0.1;
+	return f;
+}
 
-			if(buffer[1] == '-')
-			{
-				f *= -1.0;
-			}
+/**
+* Sends a command and starts its response timeout
+* @param command command
+*/
+void send_command(char command)
+{
+	// Drop the rest of a timed out response
+	while(uart.available() > 0)
+	{
+		read_byte();
+	}
 
-			value = f;
-			return true;
-		}
+	ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t> %c"), command);
+	rx_wanted = true;
+	uart.print(command);
 
-		buffer[buffer_index] = c;
-		++buffer_index;
+	++request;
+	timed_out = false;
+	error e = post_message_after(THREAD_CURRENT, MSG_EXTSENSOR_TIMEOUT, RESPONSE_TIMEOUT, request);
+	if(e != E_OK)
+	{
+		log(LOG_ERROR, MODULE_EXTSENSOR, F("EXTSNSR\tresponse timeout: %e"), e);
 	}
+}
 
-	return false;
+/**
+* Stops the response timeout of the current command
+*/
+void end_command()
+{
+	rx_wanted = false;
+
+	// A timeout that has already been queued becomes stale
+	++request;
+	cancel_message(THREAD_CURRENT, MSG_EXTSENSOR_TIMEOUT);
+}
+
+/**
+* Reports a sensor that hasn't responded in time
+*/
+void report_timeout()
+{
+	end_command();
+	log(LOG_ERROR, MODULE_EXTSENSOR, F("EXTSNSR\tno response"));
+
+	reading.status = STATUS_TIMEOUT;
+	publish(TOPIC_READINGS, MSG_EXTSENSOR_CHANGED, pack_reading(reading));
+	publish(TOPIC_SENSOR_UPDATE, MSG_SENSOR_UPDATE_END);
 }
 
-void extsensor::fsm::state_wait_for_t()
+/**
+* Sensor polling cycle. Waits for UART data (MSG_EXTSENSOR_RX), response timeouts (MSG_EXTSENSOR_TIMEOUT) 
+* and update period (MSG_TIMER). A sensor that doesn't respond is polled again after the update period
+*/
+void driver(message msg)
 {
-	if(receive_float(reading.temperature))
+	ESR_BEGIN(driver_state, msg);
+
+	while(true)
 	{
-		log(LOG_DEBUG, F("EXTSNSR\t< temperature(%f)"), &reading.temperature);
-		float c = get_ext_calibration();
-		reading.temperature += c;
+		// The first update starts right away
+		if(polled)
+		{
+			ESR_AWAIT_MS(UPDATE_PERIOD);
+		}
+
+		polled = true;
+		reading.status = STATUS_NO_DATA;
+
+		// Send 'I' to extsensor
+		log(LOG_INFO, MODULE_EXTSENSOR, F("EXTSNSR\tbegin identify"));
+		send_command(CMD_IDENTIFY);
+
+		// Received data is checked first: the timeout counts only if the response is still incomplete
+		ESR_AWAIT(uart.available() > 0 || timed_out);
+		if(uart.available() == 0)
+		{
+			report_timeout();
+			continue;
+		}
+
+		response = read_byte();
+		ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< %c"), response);
+		if(response == RESP_IDENTITY)
+		{
+			buffer_reset();
+			ESR_AWAIT((line_received = receive_line()) || timed_out);
+			if(!line_received)
+			{
+				report_timeout();
+				continue;
+			}
+
+			ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\tdevice identified"));
+		}
+		else
+		{
+			log(LOG_ERROR, MODULE_EXTSENSOR, F("EXTSNSR\tunknown device"));
+		}
+
+		end_command();
+
+		// Send 'U' to extsensor
+		log(LOG_INFO, MODULE_EXTSENSOR, F("EXTSNSR\tbegin update"));
+		send_command(CMD_UPDATE);
+
+		// Notify subscribers
+		publish(TOPIC_SENSOR_UPDATE, MSG_SENSOR_UPDATE_BEGIN);
+
+		ESR_AWAIT(uart.available() >= 2 || timed_out);
+		if(uart.available() < 2)
+		{
+			report_timeout();
+			continue;
+		}
 
-		log(LOG_DEBUG, F("EXTSNSR\t< calibration(%f)"), &c);
-		log(LOG_DEBUG, F("EXTSNSR\t< temperature_c(%f)"), &reading.temperature);
+		end_command();
+		response = read_byte();
+		read_byte();
+		ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< %c"), response);
+		reading.status = response == RESP_OK 
+			? STATUS_OK 
+			: STATUS_ERROR;
+
+		// Send 'T' to extsensor
+		send_command(CMD_GET_TEMPERATURE);
+		buffer_reset();
+
+		ESR_AWAIT((line_received = receive_line()) || timed_out);
+		if(!line_received)
+		{
+			report_timeout();
+			continue;
+		}
+
+		end_command();
+		reading.temperature = parse_float();
+		ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< temperature(%f)"), &reading.temperature);
+		{
+			float c = get_ext_calibration();
+			reading.temperature += c;
+			ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< calibration(%f)"), &c);
+			ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< temperature_c(%f)"), &reading.temperature);
+		}
 
 		// Send 'H' to extsensor
-		log(LOG_DEBUG, F("EXTSNSR\t> %c"), CMD_GET_HUMIDITY);
-		uart.print(CMD_GET_HUMIDITY);
+		send_command(CMD_GET_HUMIDITY);
 		buffer_reset();
 
-		extsensor::fsm::handler = state_wait_for_h;
+		ESR_AWAIT((line_received = receive_line()) || timed_out);
+		if(!line_received)
+		{
+			report_timeout();
+			continue;
+		}
+
+		end_command();
+		reading.humidity = parse_float();
+		ESR_LOG_DEBUG(MODULE_EXTSENSOR, F("EXTSNSR\t< humidity(%f)"), &reading.humidity);
+
+		publish(TOPIC_READINGS, MSG_EXTSENSOR_CHANGED, pack_reading(reading));
+
+		// Notify subscribers
+		publish(TOPIC_SENSOR_UPDATE, MSG_SENSOR_UPDATE_END);
 	}
+
+	ESR_END();
 }
 
-void extsensor::fsm::state_wait_for_h()
+void extsensor::poll_from_isr()
 {
-	if(receive_float(reading.humidity))
+	// Data outside of a response (ex. while waiting for the next update) doesn't wake the thread
+	if(!rx_wanted)
 	{
-		log(LOG_DEBUG, F("EXTSNSR\t< humidity(%f)"), &reading.humidity);
-		
-		set_thread_flag(THREAD_CURRENT, THREAD_IDLE_LOOP, false);
-		set_thread_flag(THREAD_CURRENT, THREAD_IMMEDIATE_TIMER, false);
-		set_timer_ms(THREAD_CURRENT, 10*1000);
+		rx_notified = 0;
+		return;
+	}
 
-		post_message(gui::thread, MSG_EXTSENSOR_CHANGED);
-		extsensor::fsm::handler = state_initial;
+	// Notify the thread once until it handles the notification
+	if(rx_pending)
+	{
+		return;
+	}
 
-		// Send message to GUI
-		post_message(gui::thread, MSG_SENSOR_UPDATE_END);
+	// Only new bytes are worth a notification, bytes the driver has seen and left unread are not
+	uint8_t count = static_cast<uint8_t>(uart.available());
+	if(count <= rx_notified)
+	{
+		rx_notified = count;
+		return;
+	}
+
+	if(post_message_from_isr(thread, MSG_EXTSENSOR_RX) == E_OK)
+	{
+		rx_notified = count;
+		rx_pending = true;
 	}
 }
 
-void extsensor::thread_func(message msg)
+void extsensor::thread_func(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_EXTSENSOR_INIT:
-		log(LOG_INFO, F("EXTSNSR\tinit"));
+		log(LOG_INFO, MODULE_EXTSENSOR, F("EXTSNSR\tinit"));
 		uart.begin(57600);
-
-		set_thread_flag(THREAD_CURRENT, THREAD_IMMEDIATE_TIMER, true);
-		set_thread_flag(THREAD_CURRENT, THREAD_REPEAT_TIMER, false);
 		set_thread_flag(THREAD_CURRENT, THREAD_IDLE_LOOP, false);
-		set_timer_ms(THREAD_CURRENT, 10*1000);
+
+		// Start polling right away
+		driver(msg);
 		break;
 
 	case MSG_TIMER:
-	case MSG_IDLE:
-		extsensor::fsm::handler();
+		driver(msg);
+		break;
+
+	case MSG_EXTSENSOR_RX:
+		rx_pending = false;
+		driver(msg);
+		break;
+
+	case MSG_EXTSENSOR_TIMEOUT:
+		// Skip timeouts of completed commands
+		if(static_cast<uint8_t>(param) == request)
+		{
+			timed_out = true;
+			driver(msg);
+		}
 		break;
 	}
 }
-
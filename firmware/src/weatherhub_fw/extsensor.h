@@ -16,9 +16,12 @@ namespace extsensor
 	extern esr::thread_id thread;
 	extern SoftwareSerial uart;
 
-	extern sensor_reading reading;
+	void thread_func(esr::message msg, esr::message_param param);
 
-	void thread_func(esr::message msg);
+	/**
+	* Notifies the thread about UART data received while it waits for a response. Called from timer interrupt
+	*/
+	void poll_from_isr();
 
 	const char CMD_NONE				= 'N';
 	const char CMD_IDENTIFY			= 'I';
@@ -35,18 +38,6 @@ namespace extsensor
 	const char RESP_UP_TO_DATE		= 'D';
 	const char RESP_TEMPERATURE		= 'T';
 	const char RESP_HUMIDITY		= 'H';
-
-	namespace fsm
-	{
-		typedef void (*state)();
-
-		extern state handler;
-
-		void state_initial();
-		void state_wait_for_update();
-		void state_wait_for_t();
-		void state_wait_for_h();
-	}
 }
 
 #endif
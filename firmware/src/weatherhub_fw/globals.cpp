@@ -0,0 +1,30 @@
+#include "globals.h"
+
+using namespace esr;
+
+/**
+* Packs a sensor reading into a message parameter.
+* Values are rounded to 0.1: temperature takes upper 16 bits, status and humidity take lower 16 bits.
+*/
+message_param pack_reading(const sensor_reading& reading)
+{
+	int16_t t = static_cast<int16_t>(reading.temperature * 10.0 + (reading.temperature >= 0 ? 0.5 : -0.5));
+	uint16_t h = static_cast<uint16_t>(reading.humidity * 10.0 + 0.5) & 0x3FFF;
+	uint16_t s = static_cast<uint16_t>(reading.status) << 14;
+
+	return (static_cast<message_param>(static_cast<uint16_t>(t)) << 16) | s | h;
+}
+
+/**
+* Unpacks a sensor reading from a message parameter
+*/
+void unpack_reading(message_param param, sensor_reading& reading)
+{
+	int16_t t = static_cast<int16_t>(param >> 16);
+	uint16_t h = static_cast<uint16_t>(param) & 0x3FFF;
+	uint8_t s = static_cast<uint8_t>(static_cast<uint16_t>(param) >> 14);
+
+	reading.status = static_cast<sensor_status>(s);
+	reading.temperature = t / 10.0;
+	reading.humidity = h / 10.0;
+}
@@ -21,12 +21,42 @@ const esr::message MSG_EXTSENSOR_INIT		= esr::MSG_USER + 8;
 const esr::message MSG_EXTSENSOR_CHANGED	= esr::MSG_USER + 9;
 const esr::message MSG_SENSOR_UPDATE_BEGIN	= esr::MSG_USER + 10;
 const esr::message MSG_SENSOR_UPDATE_END	= esr::MSG_USER + 11;
+const esr::message MSG_GUI_REFRESH			= esr::MSG_USER + 12;
+const esr::message MSG_INPUT_CHANGED		= esr::MSG_USER + 13;
+const esr::message MSG_EXTSENSOR_RX			= esr::MSG_USER + 14;
+const esr::message MSG_GUI_PROGRESS			= esr::MSG_USER + 15;
+const esr::message MSG_INPUT_REPEAT			= esr::MSG_USER + 16;
+const esr::message MSG_CONSOLE_INIT			= esr::MSG_USER + 17;
+const esr::message MSG_EXTSENSOR_TIMEOUT	= esr::MSG_USER + 18;
+
+/**
+* Log modules. Their log levels are set with the console 'l' command and kept in EEPROM
+*/
+const esr::log_module MODULE_APP			= esr::LOG_MODULE_DEFAULT;
+const esr::log_module MODULE_GUI			= 1;
+const esr::log_module MODULE_BACKLIGHT		= 2;
+const esr::log_module MODULE_INPUT			= 3;
+const esr::log_module MODULE_INTSENSOR		= 4;
+const esr::log_module MODULE_EXTSENSOR		= 5;
+const esr::log_module MODULE_SETTINGS		= 6;
+const esr::log_module MODULE_CONSOLE		= 7;
+
+/**
+* Sensor readings: MSG_INTSENSOR_CHANGED, MSG_EXTSENSOR_CHANGED
+*/
+const esr::topic_id TOPIC_READINGS			= 0;
+
+/**
+* Sensor update progress: MSG_SENSOR_UPDATE_BEGIN, MSG_SENSOR_UPDATE_END
+*/
+const esr::topic_id TOPIC_SENSOR_UPDATE		= 1;
 
 enum sensor_status
 {
 	STATUS_OK,
 	STATUS_NO_DATA,
-	STATUS_ERROR
+	STATUS_ERROR,
+	STATUS_TIMEOUT
 };
 
 struct sensor_reading
@@ -36,5 +66,16 @@ struct sensor_reading
 	float humidity;
 };
 
+/**
+* Packs a sensor reading into a message parameter.
+* Values are rounded to 0.1: temperature takes upper 16 bits, status and humidity take lower 16 bits.
+*/
+esr::message_param pack_reading(const sensor_reading& reading);
+
+/**
+* Unpacks a sensor reading from a message parameter
+*/
+void unpack_reading(esr::message_param param, sensor_reading& reading);
+
 #endif
 
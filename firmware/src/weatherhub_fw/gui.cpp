@@ -15,8 +15,14 @@ Adafruit_PCD8544	gui::lcd  = Adafruit_PCD8544(7, 6, 5, 4, 3);
 unit				active_unit			= UNIT_C;
 sensor_id			active_sensor		= SENSOR_INT;
 
+sensor_reading		int_reading			= { STATUS_NO_DATA, 0, 0 };
+sensor_reading		ext_reading			= { STATUS_NO_DATA, 0, 0 };
+
 bool				enable_progress_bar = false;
 uint8_t				progress_bar_state  = 0;
+timer_id			progress_timer;
+
+const timer_period	PROGRESS_PERIOD		= 100;
 
 float				calibration_base;
 float				calibration_offset;
@@ -69,65 +75,11 @@ void gui_frame(const __FlashStringHelper* title)
 	}
 }
 
-uint16_t power_of_10(uint8_t p)
-{
-	uint16_t r = 1;
-	for(uint8_t i = 0; i < p; ++i)
-	{
-		r *= 10;
-	}
-	return r;
-}
-
-char gui_get_digit(uint16_t value, uint8_t index)
-{
-	/*
-	123155
-	^ 2
-	% 1000 = 10 ^ (i + 1) 
-	155
-	/ 100 = 10 ^ i
-	1
-	*/
-
-	uint8_t d = static_cast<uint8_t>(
-		value % power_of_10(index + 1)
-		/  power_of_10(index)
-		);
-
-	return d + '0';
-}
-
-void gui_print_float(float& f, char* buffer)
-{
-	uint16_t value = static_cast<uint16_t>(abs( f * 10.0));
-
-	buffer[0] = f >= 0 ? '+' : '-';
-	buffer[1] = gui_get_digit(value, 3);
-	buffer[2] = gui_get_digit(value, 2);
-	buffer[3] = gui_get_digit(value, 1);
-	buffer[4] = '.';
-	buffer[5] = gui_get_digit(value, 0);
-	buffer[6] = 0;
-
-	if(buffer[1] == '0')
-	{
-		buffer[1] = ' ';
-
-		if(buffer[2] == '0')
-		{
-			buffer[2] = ' ';
-		}
-	}
-}
-
 void gui_value(int16_t y, float& v, unit u)
 {
-	char text[7] = "";
-	gui_print_float(v, text);
-	text[4] = 0;
-	text[5] = 0;
-	text[6] = 0;
+	// Whole units in 4 columns, the sign stays in the first one: "+ 23"
+	char text[NUMBER_BUFFER_SIZE];
+	format_int(text, static_cast<int32_t>(v), 4, NUMBER_PLUS | NUMBER_SIGN_FIRST);
 
 	if(u == UNIT_K || u == UNIT_PERCENT)
 	{
@@ -209,7 +161,7 @@ void gui_scroll_unit()
 	}
 
 	set_unit(active_unit);
-	log(LOG_DEBUG, F("GUI\tactive_sensor = %ps"), name);
+	ESR_LOG_DEBUG(MODULE_GUI, F("GUI\tactive_sensor = %ps"), name);
 }
 
 void gui_scroll_sensor()
@@ -229,7 +181,7 @@ void gui_scroll_sensor()
 	}
 
 	set_sensor(active_sensor);
-	log(LOG_DEBUG, F("GUI\tactive_sensor = %ps"), name);
+	ESR_LOG_DEBUG(MODULE_GUI, F("GUI\tactive_sensor = %ps"), name);
 }
 
 void gui_device_error()
@@ -248,6 +200,14 @@ void gui_no_data()
 	lcd.print(F("Updating..."));
 }
 
+void gui_no_response()
+{
+	lcd.setTextSize(1);	
+	lcd.setTextColor(BLACK);
+	lcd.setCursor(10, 23);
+	lcd.print(F("No response"));
+}
+
 void gui_reading(sensor_reading* reading)
 {	
 	float t = reading->temperature;
@@ -266,12 +226,12 @@ void gui_indicator()
 	{
 	case gui::SENSOR_INT:
 		gui_frame(F("Room"));
-		reading = &intsensor::reading;
+		reading = &int_reading;
 		break;
 
 	case gui::SENSOR_EXT:
 		gui_frame(F("Street"));
-		reading = &extsensor::reading;
+		reading = &ext_reading;
 		break;
 	}
 
@@ -286,6 +246,9 @@ void gui_indicator()
 	case STATUS_ERROR:
 		gui_device_error();
 		break;
+	case STATUS_TIMEOUT:
+		gui_no_response();
+		break;
 	}
 }
 
@@ -314,12 +277,12 @@ void gui_calibration()
 
 fsm_state gui::fsm::handler = state_initial;
 
-void gui::fsm::state_initial(message msg)
+void gui::fsm::state_initial(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_GUI_INIT:
-		log(LOG_INFO, F("GUI\tinit"));
+		log(LOG_INFO, MODULE_GUI, F("GUI\tinit"));
 
 		lcd.begin();
 		lcd.setContrast(45);
@@ -327,6 +290,8 @@ void gui::fsm::state_initial(message msg)
 		gui_bootscreen();
 		handler = state_indicator;
 
+		create_timer(THREAD_CURRENT, MSG_GUI_PROGRESS, progress_timer);
+
 		active_unit = get_unit();
 		set_unit(active_unit);
 
@@ -336,48 +301,31 @@ void gui::fsm::state_initial(message msg)
 	}
 }
 
-void gui::fsm::state_indicator(message msg)
+void gui::fsm::state_indicator(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_INTSENSOR_CHANGED:
 	case MSG_EXTSENSOR_CHANGED:
-		log(LOG_INFO, F("GUI\tindicator"));
+	case MSG_GUI_REFRESH:
+		log(LOG_INFO, MODULE_GUI, F("GUI\tindicator"));
 		gui_indicator();
 		lcd.display();
 		break;
 
 	case MSG_BNTPRESS_UNIT:
 		gui_scroll_unit();
-		switch (active_sensor)
-		{
-		case gui::SENSOR_INT:
-			post_message(THREAD_CURRENT, MSG_INTSENSOR_CHANGED);
-			break;
-
-		case gui::SENSOR_EXT:
-			post_message(THREAD_CURRENT, MSG_EXTSENSOR_CHANGED);
-			break;
-		}		
+		post_message(THREAD_CURRENT, MSG_GUI_REFRESH);
 		break;
 
 	case MSG_BNTPRESS_SENSOR:
 		gui_scroll_sensor();
-		switch (active_sensor)
-		{
-		case gui::SENSOR_INT:
-			post_message(THREAD_CURRENT, MSG_INTSENSOR_CHANGED);
-			break;
-
-		case gui::SENSOR_EXT:
-			post_message(THREAD_CURRENT, MSG_EXTSENSOR_CHANGED);
-			break;
-		}
+		post_message(THREAD_CURRENT, MSG_GUI_REFRESH);
 		break;
 
 
 	case MSG_BNTPRESS_MODE:
-		log(LOG_INFO, F("GUI\tindicator calibrate"));
+		log(LOG_INFO, MODULE_GUI, F("GUI\tindicator calibrate"));
 		handler = state_calibration;
 		post_message(THREAD_CURRENT, MSG_GUI_INIT);	
 		break;
@@ -386,7 +334,7 @@ void gui::fsm::state_indicator(message msg)
 	case MSG_SENSOR_UPDATE_BEGIN:
 		enable_progress_bar = true;
 		progress_bar_state = 0;
-		set_timer_ms(THREAD_CURRENT, 100);
+		start_timer(progress_timer, PROGRESS_PERIOD, PROGRESS_PERIOD);
 		gui_indicator();
 		lcd.display();
 		break;
@@ -394,33 +342,33 @@ void gui::fsm::state_indicator(message msg)
 	case MSG_SENSOR_UPDATE_END:
 		enable_progress_bar = false;
 		progress_bar_state = 0;
-		clear_timer(THREAD_CURRENT);
+		stop_timer(progress_timer);
 		gui_indicator();
 		lcd.display();
 		break;
 
-	case MSG_TIMER:
+	case MSG_GUI_PROGRESS:
 		gui_indicator();
 		lcd.display();
 		break;
 	}
 }
 
-void gui::fsm::state_calibration(message msg)
+void gui::fsm::state_calibration(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_GUI_INIT:
 		// init calibration mode
-		log(LOG_INFO, F("GUI\tcalibration init"));
+		log(LOG_INFO, MODULE_GUI, F("GUI\tcalibration init"));
 		switch (active_sensor)
 		{
 		case gui::SENSOR_INT:
-			calibration_base = intsensor::reading.temperature;
+			calibration_base = int_reading.temperature;
 			calibration_offset = get_int_calibration();
 			break;
 		case gui::SENSOR_EXT:
-			calibration_base = extsensor::reading.temperature;
+			calibration_base = ext_reading.temperature;
 			calibration_offset = get_ext_calibration();
 			break;
 		default:
@@ -432,38 +380,49 @@ void gui::fsm::state_calibration(message msg)
 
 	case MSG_BNTPRESS_MODE:
 		// commit		
-		log(LOG_INFO, F("GUI\tcalibration commit"));
+		log(LOG_INFO, MODULE_GUI, F("GUI\tcalibration commit"));
 		handler = state_indicator;
 		switch (active_sensor)
 		{
 		case SENSOR_INT:
 			set_int_calibration(calibration_offset);
-			post_message(THREAD_CURRENT, MSG_INTSENSOR_CHANGED);
 			break;
 		case SENSOR_EXT:
 			set_ext_calibration(calibration_offset);
-			post_message(THREAD_CURRENT, MSG_EXTSENSOR_CHANGED);
 			break;
 		}
+		post_message(THREAD_CURRENT, MSG_GUI_REFRESH);
 		break;
 
 	case MSG_BNTPRESS_UNIT:
 		// increment calibration
 		calibration_offset = clamp_calibration(calibration_offset + 1);
-		log(LOG_INFO, F("GUI\tcalibration inc %f"), &calibration_offset);
+		log(LOG_INFO, MODULE_GUI, F("GUI\tcalibration inc %f"), &calibration_offset);
 		gui_calibration();
 		break;
 
 	case MSG_BNTPRESS_SENSOR:
 		// decrement calibration
 		calibration_offset = clamp_calibration(calibration_offset - 1);
-		log(LOG_INFO, F("GUI\tcalibration dec %f"), &calibration_offset);
+		log(LOG_INFO, MODULE_GUI, F("GUI\tcalibration dec %f"), &calibration_offset);
 		gui_calibration();
 		break;
 	}
 }
 
-void gui::thread_func(message msg)
+void gui::thread_func(message msg, message_param param)
 {
-	handler(msg);
+	// Keep the latest readings regardless of the active screen
+	switch (msg)
+	{
+	case MSG_INTSENSOR_CHANGED:
+		unpack_reading(param, int_reading);
+		break;
+
+	case MSG_EXTSENSOR_CHANGED:
+		unpack_reading(param, ext_reading);
+		break;
+	}
+
+	handler(msg, param);
 }
@@ -31,17 +31,17 @@ namespace gui
 	extern esr::thread_id thread;
 	extern Adafruit_PCD8544 lcd;
 
-	void thread_func(esr::message msg);
+	void thread_func(esr::message msg, esr::message_param param);
 
 	namespace fsm
 	{
-		typedef void (*fsm_state)(esr::message msg);
+		typedef void (*fsm_state)(esr::message msg, esr::message_param param);
 
 		extern fsm_state handler;
 
-		void state_initial(esr::message msg);
-		void state_indicator(esr::message msg);
-		void state_calibration(esr::message msg);
+		void state_initial(esr::message msg, esr::message_param param);
+		void state_indicator(esr::message msg, esr::message_param param);
+		void state_calibration(esr::message msg, esr::message_param param);
 	}
 }
 
@@ -7,8 +7,13 @@ using namespace input;
 
 const long KEYPAD_PERIOD  = 250;
 
+const uint8_t BTN1_MASK = 1 << 0;
+const uint8_t BTN2_MASK = 1 << 1;
+const uint8_t BTN3_MASK = 1 << 2;
+
 thread_id input::thread;
 long last_update_time = -1;
+volatile uint8_t sampled_state;
 
 enum button
 {
@@ -18,68 +23,93 @@ enum button
 	BTN_UNIT	= MSG_BNTPRESS_UNIT
 };
 
-button read_button()
+button read_button(uint8_t state)
 {
-	uint8_t value1 = digitalRead(BTN1_PIN);
-	uint8_t value2 = digitalRead(BTN2_PIN);
-	uint8_t value3 = digitalRead(BTN3_PIN);
-
-	if(value1 != 0 ||
-		value2 != 0 ||
-		value3 != 0)
+	if(state != 0)
 	{
-		log(LOG_DEBUG, F("INPUT\tbtn state [ %c %c %c ]"), 
-			value1 == HIGH ? '1': '0',
-			value2 == HIGH ? '1': '0',
-			value3 == HIGH ? '1': '0');
+		ESR_LOG_DEBUG(MODULE_INPUT, F("INPUT\tbtn state [ %c %c %c ]"), 
+			(state & BTN1_MASK) != 0 ? '1': '0',
+			(state & BTN2_MASK) != 0 ? '1': '0',
+			(state & BTN3_MASK) != 0 ? '1': '0');
 	}
 
-	if(value1 == HIGH)
+	if((state & BTN1_MASK) != 0)
 	{
-		log(LOG_INFO, F("INPUT\tpressed <UNIT>"));
+		log(LOG_INFO, MODULE_INPUT, F("INPUT\tpressed <UNIT>"));
 		return BTN_UNIT;
 	}
 
-	if(value2 == HIGH)
+	if((state & BTN2_MASK) != 0)
 	{
-		log(LOG_INFO, F("INPUT\tpressed <MODE>"));
+		log(LOG_INFO, MODULE_INPUT, F("INPUT\tpressed <MODE>"));
 		return BTN_MODE;
 	}
 
-	if(value3 == HIGH)
+	if((state & BTN3_MASK) != 0)
 	{
-		log(LOG_INFO, F("INPUT\tpressed <SENSOR>"));
+		log(LOG_INFO, MODULE_INPUT, F("INPUT\tpressed <SENSOR>"));
 		return BTN_SENSOR;
 	}
 
 	return BTN_NONE;
 }
 
-void input::thread_func(esr::message msg)
+void input::poll_from_isr()
+{
+	// Buttons are on PC0..PC2, one port read instead of three digitalRead() calls
+	uint8_t state = PINC & (BTN1_MASK | BTN2_MASK | BTN3_MASK);
+
+	if(state != sampled_state && 
+		post_message_from_isr(thread, MSG_INPUT_CHANGED, state) == E_OK)
+	{
+		sampled_state = state;
+	}
+}
+
+void input::thread_func(esr::message msg, esr::message_param param)
 {
 	switch (msg)
 	{
 	case MSG_INPUT_INIT:
-		log(LOG_INFO, F("INPUT\tinit"));
+		log(LOG_INFO, MODULE_INPUT, F("INPUT\tinit"));
 		pinMode(BTN1_PIN, INPUT);
 		pinMode(BTN2_PIN, INPUT);
 		pinMode(BTN3_PIN, INPUT);
 		break;
 
-	case MSG_IDLE:
+	case MSG_INPUT_CHANGED:
 		{
-			long time = millis();
-			if(time - last_update_time < KEYPAD_PERIOD)
+			button btn = read_button(static_cast<uint8_t>(param));
+			if(btn == BTN_NONE)
 			{
+				// Buttons released, stop auto repeat
+				cancel_message(THREAD_CURRENT, MSG_INPUT_REPEAT);
 				break;
 			}
 
-			button btn = read_button();
-			if(btn != BTN_NONE)
+			// Suppress contact bounce
+			long time = millis();
+			if(time - last_update_time >= KEYPAD_PERIOD)
 			{
 				last_update_time = time;
 				post_message(gui::thread, static_cast<message>(btn));
 			}
+
+			// Repeat the button while it is held down
+			cancel_message(THREAD_CURRENT, MSG_INPUT_REPEAT);
+			post_message_after(THREAD_CURRENT, MSG_INPUT_REPEAT, KEYPAD_PERIOD);
+		}
+		break;
+
+	case MSG_INPUT_REPEAT:
+		{
+			button btn = read_button(sampled_state);
+			if(btn != BTN_NONE)
+			{
+				last_update_time = millis();
+				post_message(gui::thread, static_cast<message>(btn));
+				post_message_after(THREAD_CURRENT, MSG_INPUT_REPEAT, KEYPAD_PERIOD);
+			}
 		}
 		break;
 	}
@@ -13,11 +13,19 @@ namespace input
 {
 	extern esr::thread_id thread;
 
+	/**
+	* Button pins, poll_from_isr() reads them as bits 0..2 of port C
+	*/
 	const int BTN1_PIN = A0;
 	const int BTN2_PIN = A1;
 	const int BTN3_PIN = A2;
 
-	void thread_func(esr::message msg);
+	void thread_func(esr::message msg, esr::message_param param);
+
+	/**
+	* Samples button pins and notifies the thread about changes. Called from timer interrupt
+	*/
+	void poll_from_isr();
 }
 
 #endif
@@ -1,6 +1,5 @@
 #include "intsensor.h"
 #include "globals.h"
-#include "gui.h"
 #include "settings.h"
 
 using namespace esr;
@@ -9,14 +8,13 @@ using namespace settings;
 
 thread_id		intsensor::thread;
 DHT				intsensor::sensor(2, DHT11);
-sensor_reading	intsensor::reading;
 
-void intsensor::thread_func(message msg)
+void intsensor::thread_func(message msg, message_param param)
 {
 	switch (msg)
 	{
 	case MSG_INTSENSOR_INIT:
-		log(LOG_INFO, F("INTSNSR\tinit"));
+		log(LOG_INFO, MODULE_INTSENSOR, F("INTSNSR\tinit"));
 		sensor.begin();
 
 		set_thread_flag(THREAD_CURRENT, THREAD_IMMEDIATE_TIMER, true);
@@ -25,16 +23,17 @@ void intsensor::thread_func(message msg)
 		break;
 
 	case MSG_TIMER:
-		log(LOG_INFO, F("INTSNSR\tupdate"));
+		log(LOG_INFO, MODULE_INTSENSOR, F("INTSNSR\tupdate"));
 		
 		float t = sensor.readTemperature();
 		float h = sensor.readHumidity();
 		if(isnan(t) || isnan(h))
 		{
-			log(LOG_ERROR, F("INTSNSR\tfailure"));
+			log(LOG_ERROR, MODULE_INTSENSOR, F("INTSNSR\tfailure"));
 			break;;
 		}
 
+		sensor_reading reading;
 		reading.temperature = t;
 		reading.humidity = h;
 		reading.status = STATUS_OK;
@@ -42,10 +41,10 @@ void intsensor::thread_func(message msg)
 		float c = get_int_calibration();
 		reading.temperature += c;
 
-		log(LOG_DEBUG, F("INTSNSR\t< calibration(%f)"), &c);
-		log(LOG_INFO, F("INTSNSR\tt = %f deg C, h = %f%%"), &reading.temperature, &reading.humidity);
+		ESR_LOG_DEBUG(MODULE_INTSENSOR, F("INTSNSR\t< calibration(%f)"), &c);
+		log(LOG_INFO, MODULE_INTSENSOR, F("INTSNSR\tt = %f deg C, h = %f%%"), &reading.temperature, &reading.humidity);
 		
-		post_message(gui::thread, MSG_INTSENSOR_CHANGED);
+		publish(TOPIC_READINGS, MSG_INTSENSOR_CHANGED, pack_reading(reading));
 
 		break;
 	}
@@ -16,9 +16,7 @@ namespace intsensor
 	extern esr::thread_id thread;
 	extern DHT sensor;
 
-	extern sensor_reading reading;
-
-	void thread_func(esr::message msg);
+	void thread_func(esr::message msg, esr::message_param param);
 }
 
 #endif
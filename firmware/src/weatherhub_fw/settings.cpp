@@ -1,4 +1,5 @@
 #include "settings.h"
+#include "globals.h"
 #include <esr.h>
 
 using namespace esr;
@@ -7,6 +8,75 @@ using namespace settings;
 
 const int EEPROM_FIRST_RUN = 0;
 
+/**
+* Amount of EEPROM cells used by settings
+*/
+const int EEPROM_SIZE = 7;
+
+/**
+* Values written since the last flush, not yet in EEPROM
+*/
+uint8_t _pending_values[EEPROM_SIZE];
+
+/**
+* Cells with pending values, one bit per EEPROM address
+*/
+uint8_t _pending_cells;
+
+/**
+* Writes pending values into EEPROM. 
+* An EEPROM write takes ~3.3 ms so it's done as deferred work, behind message handling
+* @param param unused
+*/
+void flush(message_param param)
+{
+	for(int address = 0; address < EEPROM_SIZE; ++address)
+	{
+		if((_pending_cells & (1 << address)) != 0)
+		{
+			// Unchanged cells aren't rewritten to save EEPROM wear
+			if(EEPROM.read(address) != _pending_values[address])
+			{
+				EEPROM.write(address, _pending_values[address]);
+			}
+		}
+	}
+
+	_pending_cells = 0;
+}
+
+/**
+* Reads a settings value, either pending or stored in EEPROM
+* @param address EEPROM address
+* @return value
+*/
+uint8_t read(int address)
+{
+	if((_pending_cells & (1 << address)) != 0)
+	{
+		return _pending_values[address];
+	}
+
+	return EEPROM.read(address);
+}
+
+/**
+* Writes a settings value. EEPROM is updated later when the scheduler has nothing else to do
+* @param address EEPROM address
+* @param value value
+*/
+void write(int address, uint8_t value)
+{
+	_pending_values[address] = value;
+	_pending_cells |= 1 << address;
+
+	// Write synchronously if the deferred work queue is full
+	if(defer(flush) != E_OK)
+	{
+		flush(0);
+	}
+}
+
 void settings::init()
 {
 	uint8_t x = EEPROM.read(EEPROM_FIRST_RUN);
@@ -17,8 +87,15 @@ void settings::init()
 		set_int_calibration(0);
 		set_ext_calibration(0);
 
+		// Defaults have to be stored before the first run mark
+		flush(0);
 		EEPROM.write(EEPROM_FIRST_RUN, 0xEE);
 	}
+
+	for(log_module module = 0; module < LOG_MODULES; ++module)
+	{
+		esr::set_log_level(module, get_log_level(module));
+	}
 }
 
 
@@ -26,13 +103,13 @@ const int EEPROM_UNIT = 1;
 
 unit settings::get_unit()
 {
-	uint8_t x = EEPROM.read(EEPROM_UNIT);
+	uint8_t x = read(EEPROM_UNIT);
 	return static_cast<unit>(x);
 }
 
 void settings::set_unit(unit unit)
 {
-	EEPROM.write(EEPROM_UNIT, static_cast<uint8_t>(unit));
+	write(EEPROM_UNIT, static_cast<uint8_t>(unit));
 }
 
 
@@ -40,13 +117,13 @@ const int EEPROM_SENSOR = 2;
 
 sensor_id settings::get_sensor()
 {
-	uint8_t x = EEPROM.read(EEPROM_SENSOR);
+	uint8_t x = read(EEPROM_SENSOR);
 	return static_cast<sensor_id>(x);
 }
 
 void settings::set_sensor(sensor_id id)
 {
-	EEPROM.write(EEPROM_SENSOR, static_cast<uint8_t>(id));
+	write(EEPROM_SENSOR, static_cast<uint8_t>(id));
 }
 
 
@@ -55,7 +132,7 @@ const int EEPROM_EXT_CALIBRATION = 4;
 
 float get_calibration(int address)
 {
-	int8_t value = static_cast<int8_t>(EEPROM.read(address));	
+	int8_t value = static_cast<int8_t>(read(address));	
 	float calibration = static_cast<float>(value - 127);
 	return calibration;
 }
@@ -63,7 +140,7 @@ float get_calibration(int address)
 void set_calibration(int address, float calibration)
 {
 	int8_t value = static_cast<int8_t>(calibration);
-	EEPROM.write(address, value + 127);
+	write(address, value + 127);
 }
 
 
@@ -94,12 +171,36 @@ float settings::get_ext_calibration()
 
 void settings::set_int_calibration(float c)
 {
-	log(LOG_DEBUG, F("EEPROM\tset_int_calibration(%f)"), &c);
+	ESR_LOG_DEBUG(MODULE_SETTINGS, F("EEPROM\tset_int_calibration(%f)"), &c);
 	set_calibration(EEPROM_INT_CALIBRATION, c);
 }
 
 void settings::set_ext_calibration(float c)
 {
-	log(LOG_DEBUG, F("EEPROM\tset_ext_calibration(%f)"), &c);
+	ESR_LOG_DEBUG(MODULE_SETTINGS, F("EEPROM\tset_ext_calibration(%f)"), &c);
 	set_calibration(EEPROM_EXT_CALIBRATION, c);
+}
+
+
+/**
+* Log levels of modules, 2 bits per module, 4 modules per cell. 
+* Levels are stored inverted, so cells that have never been written (0xFF) mean LOG_DEBUG
+*/
+const int EEPROM_LOG_LEVELS = 5;
+
+log_level settings::get_log_level(log_module module)
+{
+	uint8_t shift = (module & 0x03) * 2;
+	uint8_t x = read(EEPROM_LOG_LEVELS + module / 4);
+	return static_cast<log_level>(LOG_DISABLED - ((x >> shift) & 0x03));
+}
+
+void settings::set_log_level(log_module module, log_level level)
+{
+	ESR_LOG_DEBUG(MODULE_SETTINGS, F("EEPROM\tset_log_level(%ub, %ub)"), module, static_cast<uint8_t>(level));
+
+	int address = EEPROM_LOG_LEVELS + module / 4;
+	uint8_t shift = (module & 0x03) * 2;
+	uint8_t x = read(address) & ~(0x03 << shift);
+	write(address, x | ((LOG_DISABLED - level) << shift));
 }
\ No newline at end of file
@@ -29,6 +29,9 @@ namespace settings
 
 	void			set_int_calibration(float c);
 	void			set_ext_calibration(float c);
+
+	esr::log_level	get_log_level(esr::log_module module);
+	void			set_log_level(esr::log_module module, esr::log_level level);
 }
 
 #endif
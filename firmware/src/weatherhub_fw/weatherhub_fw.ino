@@ -7,6 +7,7 @@
 #include "gui.h"
 #include "globals.h"
 #include "settings.h"
+#include "console.h"
 #include <esr.h>
 #include <Adafruit_PCD8544.h>
 #include <Adafruit_GFX.h>
@@ -18,23 +19,61 @@ SoftwareSerial	extsensor::uart(A5, A4);
 
 void setup()
 {
+	// Hung thread resets MCU
+	watchdog_init();
+
 	// Setup logging
 	Serial.begin(57600);
 	log_init(Serial);
-	log(LOG_INFO, F("APP\tstartup"));
+	log(LOG_INFO, MODULE_APP, F("APP\tstartup"));
+
+	thread_id culprit;
+	message culprit_msg;
+	if(get_reset_culprit(culprit, culprit_msg) == E_OK)
+	{
+		log(LOG_ERROR, MODULE_APP, F("APP\treset by thread %ub, msg=%ub"), culprit, culprit_msg);
+	}
+
+	// Only the latest reading and a single redraw request are worth keeping in a message queue
+	set_message_coalescing(MSG_INTSENSOR_CHANGED, true);
+	set_message_coalescing(MSG_EXTSENSOR_CHANGED, true);
+	set_message_coalescing(MSG_GUI_REFRESH, true);
 
 	// Start threads
+	// Button handling (input -> gui) runs before sensor updates.
+	// Threads share the mailbox pool, queues of ones that receive few messages are shrunk right away
 	begin_thread(gui::thread_func, gui::thread);
 	set_thread_flag(gui::thread, THREAD_IDLE_LOOP, false);
+	set_thread_priority(gui::thread, PRIORITY_HIGH);
+	// A button press and the redraw it requests are handled within the same scheduler loop iteration
+	set_thread_drain(gui::thread, DRAIN_ALL);
+	subscribe(gui::thread, TOPIC_READINGS);
+	subscribe(gui::thread, TOPIC_SENSOR_UPDATE);
 
 	begin_thread(backlight::thread_func, backlight::thread);
 	set_thread_flag(backlight::thread, THREAD_IDLE_LOOP, false);
+	set_thread_queue_size(backlight::thread, 1);
 
 	begin_thread(intsensor::thread_func, intsensor::thread);
 	set_thread_flag(intsensor::thread, THREAD_IDLE_LOOP, false);
+	set_thread_priority(intsensor::thread, PRIORITY_LOW);
+	set_thread_queue_size(intsensor::thread, 1);
+	// DHT sensor read takes about half a second
+	set_thread_time_budget(intsensor::thread, 1000);
 
 	begin_thread(input::thread_func, input::thread);
+	set_thread_flag(input::thread, THREAD_IDLE_LOOP, false);
+	set_thread_priority(input::thread, PRIORITY_HIGH);
+	set_thread_queue_size(input::thread, 3);
+
 	begin_thread(extsensor::thread_func, extsensor::thread);
+	set_thread_priority(extsensor::thread, PRIORITY_LOW);
+	set_thread_queue_size(extsensor::thread, 3);
+
+	begin_thread(console::thread_func, console::thread);
+	set_thread_flag(console::thread, THREAD_IDLE_LOOP, false);
+	set_thread_priority(console::thread, PRIORITY_LOW);
+	set_thread_queue_size(console::thread, 1);
 
 	settings::init();
 		
@@ -44,11 +83,30 @@ void setup()
 	post_message(intsensor::thread, MSG_INTSENSOR_INIT);
 	post_message(input::thread, MSG_INPUT_INIT);
 	post_message(extsensor::thread, MSG_EXTSENSOR_INIT);
+	post_message(console::thread, MSG_CONSOLE_INIT);
+
+	// Piggyback Timer0 (millis() timer) with a compare match interrupt, it fires once per millisecond
+	OCR0A = 0x80;
+	TIMSK0 |= _BV(OCIE0A);
+}
+
+ISR(TIMER0_COMPA_vect)
+{
+	extsensor::poll_from_isr();
+
+	// Sample buttons every 8 ms
+	static uint8_t ticks = 0;
+	if((++ticks & 0x07) == 0)
+	{
+		input::poll_from_isr();
+	}
 }
 
 void loop()
 {
-	// Run scheduler loop
+	// Run scheduler loop. run_cycle() puts MCU to sleep (SLEEP_MODE_IDLE) while no thread is ready and no timer is due.
+	// A thread with THREAD_IDLE_LOOP is always ready, so every thread clears it (extsensor does it on MSG_EXTSENSOR_INIT).
+	// Timer0 interrupts still wake MCU every millisecond for millis() and button/UART polling
 	run_cycle();
 }
 
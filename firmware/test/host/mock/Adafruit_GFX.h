@@ -0,0 +1,6 @@
+#ifndef _ADAFRUIT_GFX_H
+#define _ADAFRUIT_GFX_H
+
+// gui.h only declares the display, host tests don't draw
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _ADAFRUIT_PCD8544_H
+#define _ADAFRUIT_PCD8544_H
+
+class Adafruit_PCD8544;
+
+#endif
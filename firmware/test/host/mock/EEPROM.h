@@ -0,0 +1,6 @@
+#ifndef _EEPROM_MOCK_h
+#define _EEPROM_MOCK_h
+
+// Firmware modules under test don't touch EEPROM, settings.h only needs the header
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _SoftwareSerial_h
+#define _SoftwareSerial_h
+
+#include "Arduino.h"
+#include <string>
+
+/**
+* Software UART of host tests: tests put received bytes into rx, written bytes are collected in tx
+*/
+class SoftwareSerial : public Print
+{
+public:
+	std::string rx;
+	std::string tx;
+
+	SoftwareSerial(uint8_t rx_pin, uint8_t tx_pin)
+	{
+	}
+
+	void begin(long speed)
+	{
+	}
+
+	int available()
+	{
+		return static_cast<int>(rx.size());
+	}
+
+	int read()
+	{
+		if(rx.empty())
+		{
+			return -1;
+		}
+
+		uint8_t c = static_cast<uint8_t>(rx[0]);
+		rx.erase(0, 1);
+		return c;
+	}
+
+	using Print::write;
+
+	size_t write(uint8_t c)
+	{
+		tx += static_cast<char>(c);
+		return 1;
+	}
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "esr_test.h"
+#include "extsensor.h"
+#include "settings.h"
+#include <vector>
+
+using namespace esr;
+
+SoftwareSerial extsensor::uart(0, 0);
+
+float settings::get_ext_calibration()
+{
+	return 0;
+}
+
+/**
+* UART speed of the external sensor: 57600 baud take about 6 bytes per millisecond
+*/
+const uint8_t BYTES_PER_MS = 6;
+
+/**
+* Simulated external sensor: answers commands written into the UART,
+* responses arrive at the UART speed starting from the next millisecond
+*/
+static std::string _pending;
+
+static void sensor_step(bool respond)
+{
+	std::string& tx = extsensor::uart.tx;
+	for(size_t i = 0; i < tx.size() && respond; ++i)
+	{
+		switch(tx[i])
+		{
+		case extsensor::CMD_IDENTIFY: _pending += "IWEATHERHUB EXTSENSOR\n"; break;
+		case extsensor::CMD_UPDATE: _pending += "O\n"; break;
+		case extsensor::CMD_GET_TEMPERATURE: _pending += "T+023.5\n"; break;
+		case extsensor::CMD_GET_HUMIDITY: _pending += "H+045.6\n"; break;
+		}
+	}
+
+	tx.clear();
+	size_t count = _pending.size() < BYTES_PER_MS ? _pending.size() : BYTES_PER_MS;
+	extsensor::uart.rx += _pending.substr(0, count);
+	_pending.erase(0, count);
+}
+
+/**
+* Readings published by extsensor thread
+*/
+static std::vector<sensor_reading> _readings;
+
+static void display_thread(message msg, message_param param)
+{
+	if(msg == MSG_EXTSENSOR_CHANGED)
+	{
+		sensor_reading reading;
+		unpack_reading(param, reading);
+		_readings.push_back(reading);
+	}
+}
+
+/**
+* Starts extsensor thread as the firmware does and a thread that records readings.
+* The idle loop of the recording thread keeps virtual time from jumping to the next deadline
+*/
+static void start_threads()
+{
+	thread_id display = 0;
+	ASSERT_EQ(E_OK, begin_thread(display_thread, display));
+	ASSERT_EQ(E_OK, subscribe(display, TOPIC_READINGS));
+
+	ASSERT_EQ(E_OK, begin_thread(extsensor::thread_func, extsensor::thread));
+	ASSERT_EQ(E_OK, set_thread_queue_size(extsensor::thread, 3));
+	ASSERT_EQ(E_OK, post_message(extsensor::thread, MSG_EXTSENSOR_INIT));
+}
+
+/**
+* Runs the firmware for a while: the sensor, the 1 ms polling interrupt and the scheduler loop
+* @param ms time in milliseconds
+* @param respond true if the sensor answers commands
+* @param notify true if the polling interrupt runs
+*/
+static void run_ms(uint16_t ms, bool respond = true, bool notify = true)
+{
+	for(uint16_t i = 0; i < ms; ++i)
+	{
+		sensor_step(respond);
+		if(notify)
+		{
+			extsensor::poll_from_isr();
+		}
+
+		run_cycle();
+		host::advance_us(1000);
+	}
+}
+
+TEST(extsensor, response_in_pieces)
+{
+	// Each response takes a few polling periods, the driver wakes up for the last piece too
+	start_threads();
+	run_ms(100);
+
+	ASSERT_EQ(1u, _readings.size());
+	EXPECT_EQ(STATUS_OK, _readings[0].status);
+	EXPECT_EQ(23.5f, _readings[0].temperature);
+	EXPECT_EQ(45.6f, _readings[0].humidity);
+
+	// The next update comes after the update period
+	run_ms(10000);
+	ASSERT_EQ(2u, _readings.size());
+	EXPECT_EQ(STATUS_OK, _readings[1].status);
+}
+
+TEST(extsensor, no_response)
+{
+	start_threads();
+	run_ms(1100, false);
+
+	ASSERT_EQ(1u, _readings.size());
+	EXPECT_EQ(STATUS_TIMEOUT, _readings[0].status);
+
+	// The sensor is polled again after the update period
+	run_ms(10100);
+	ASSERT_EQ(2u, _readings.size());
+	EXPECT_EQ(STATUS_OK, _readings[1].status);
+}
+
+TEST(extsensor, complete_response_wins_over_timeout)
+{
+	// Without notifications only the timeout wakes the driver up, the response is already complete by then
+	start_threads();
+	run_ms(1100, true, false);
+
+	EXPECT_EQ(0u, _readings.size());
+	run_ms(3100, true, false);
+
+	ASSERT_EQ(1u, _readings.size());
+	EXPECT_EQ(STATUS_OK, _readings[0].status);
+	EXPECT_EQ(23.5f, _readings[0].temperature);
+}